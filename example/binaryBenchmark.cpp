@@ -0,0 +1,134 @@
+#include <Arduino.h>
+#include <vector>
+#include "../src/PAT_dataValidator.h"
+#include "../src/PAT_binaryValidator.h"
+//___________________________________________________________________________________________
+// JSON text vs MessagePack vs CBOR
+//
+// Validates the same logical documents three ways and prints the mean time per document:
+//   json     deserializeJson + Validator::isValid
+//   msgpack  deserializeMsgPack + Validator::isValid
+//   direct   BinaryValidator on the MessagePack / CBOR bytes, no JsonDocument
+//-------------------------------------------------------------------
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 20000
+#endif
+
+Validator telemetryValidator;
+
+const char *documents[] = {
+    "{\"device\":\"node-17\",\"seq\":1042,\"temp\":21.5,\"hum\":40.25,\"tags\":[\"a\",\"b\"],\"fw\":\"1.4.2\"}",
+    "{\"device\":\"node-17\",\"seq\":1043,\"temp\":21.5,\"hum\":40.25,\"tags\":[\"a\",\"b\"],\"fw\":\"1.4.2\",\"blob\":\"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\"}",
+    "{\"device\":\"node-17-with-a-name-that-is-far-too-long-for-the-schema\",\"seq\":1044,\"temp\":21.5}",
+};
+const size_t documentCount = sizeof(documents) / sizeof(documents[0]);
+//___________________________________________________________________________________________
+// Minimal CBOR encoder for the benchmark input (definite lengths only)
+void cborHead(std::vector<uint8_t> &out, uint8_t major, uint64_t value)
+{
+    if (value < 24)
+        out.push_back((major << 5) | value);
+    else if (value <= 0xff)
+        out.insert(out.end(), {(uint8_t)((major << 5) | 24), (uint8_t)value});
+    else if (value <= 0xffff)
+        out.insert(out.end(), {(uint8_t)((major << 5) | 25), (uint8_t)(value >> 8), (uint8_t)value});
+    else
+        out.insert(out.end(), {(uint8_t)((major << 5) | 26), (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value});
+}
+
+void cborEncode(const JsonVariant &value, std::vector<uint8_t> &out)
+{
+    if (value.is<JsonObject>())
+    {
+        cborHead(out, 5, value.as<JsonObject>().size());
+        for (JsonPair kv : value.as<JsonObject>())
+        {
+            cborHead(out, 3, strlen(kv.key().c_str()));
+            out.insert(out.end(), kv.key().c_str(), kv.key().c_str() + strlen(kv.key().c_str()));
+            cborEncode(kv.value(), out);
+        }
+    }
+    else if (value.is<JsonArray>())
+    {
+        cborHead(out, 4, value.as<JsonArray>().size());
+        for (JsonVariant item : value.as<JsonArray>())
+            cborEncode(item, out);
+    }
+    else if (value.is<const char *>())
+    {
+        const char *str = value.as<const char *>();
+        cborHead(out, 3, strlen(str));
+        out.insert(out.end(), str, str + strlen(str));
+    }
+    else if (value.is<bool>())
+        out.push_back(value.as<bool>() ? 0xf5 : 0xf4);
+    else if (value.is<long>())
+    {
+        long v = value.as<long>();
+        if (v >= 0)
+            cborHead(out, 0, v);
+        else
+            cborHead(out, 1, -1 - v);
+    }
+    else if (value.is<float>())
+    {
+        float f = value.as<float>();
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        out.insert(out.end(), {0xfa, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits});
+    }
+    else
+        out.push_back(0xf6);
+}
+//___________________________________________________________________________________________
+template <typename Fn>
+float nanosPerCall(Fn fn)
+{
+    unsigned long start = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i)
+        fn(i);
+    return (micros() - start) * 1000.0f / BENCH_ITERATIONS;
+}
+//___________________________________________________________________________________________
+void setup()
+{
+    Serial.begin(115200);
+    while (!Serial)
+        ;
+    //-------------------------------------------
+    telemetryValidator.addField("device", FieldSchema().setType("string").setRequired(true).setLength(1, 32).setPattern("^[a-z0-9-]+$"))
+        .addField("seq", FieldSchema().setType("integer").setRequired(true).setValue(0, 1000000))
+        .addField("temp", FieldSchema().setType("float").setValue(-40, 85))
+        .addField("hum", FieldSchema().setType("float").setValue(0, 100))
+        .addField("tags", FieldSchema().setType("array").setItems(0, 8))
+        .addField("fw", FieldSchema().setType("string").setLength(5, 16));
+
+    std::vector<uint8_t> msgpack[documentCount], cbor[documentCount];
+    DynamicJsonDocument doc(1024);
+    for (size_t i = 0; i < documentCount; ++i)
+    {
+        deserializeJson(doc, documents[i]);
+        msgpack[i].resize(measureMsgPack(doc));
+        serializeMsgPack(doc, msgpack[i].data(), msgpack[i].size());
+        cborEncode(doc.as<JsonVariant>(), cbor[i]);
+    }
+    //-------------------------------------------
+    for (size_t i = 0; i < documentCount; ++i)
+    {
+        volatile bool sink = false;
+        float json = nanosPerCall([&](int)
+                                  { deserializeJson(doc, documents[i]); sink = telemetryValidator.isValid(doc.as<JsonVariant>()); });
+        float viaDoc = nanosPerCall([&](int)
+                                    { deserializeMsgPack(doc, (const char *)msgpack[i].data(), msgpack[i].size()); sink = telemetryValidator.isValid(doc.as<JsonVariant>()); });
+        float directMsgPack = nanosPerCall([&](int)
+                                           { sink = BinaryValidator::isValidMsgPack(telemetryValidator, msgpack[i].data(), msgpack[i].size()); });
+        float directCbor = nanosPerCall([&](int)
+                                        { sink = BinaryValidator::isValidCbor(telemetryValidator, cbor[i].data(), cbor[i].size()); });
+
+        Serial.printf("doc %u (%u B json, %u B msgpack, %u B cbor) valid=%d\n", (unsigned)i, (unsigned)strlen(documents[i]),
+                      (unsigned)msgpack[i].size(), (unsigned)cbor[i].size(), (int)sink);
+        Serial.printf("  json %.0f ns | msgpack+doc %.0f ns | msgpack direct %.0f ns | cbor direct %.0f ns\n", json, viaDoc, directMsgPack, directCbor);
+    }
+}
+//___________________________________________________________________________________________
+void loop() {}
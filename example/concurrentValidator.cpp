@@ -0,0 +1,103 @@
+#include <Arduino.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/PAT_dataValidator.h"
+//___________________________________________________________________________________________
+// Concurrency stress test
+//
+// One Validator instance is shared by every worker thread, each with its own JsonDocument and
+// ValidationContext. Runs on the ESP32 (std::thread maps onto FreeRTOS tasks) and on a host build,
+// printing throughput per thread count; on an idle machine it should scale close to linearly up to the
+// number of cores. Any disagreement with the single-threaded verdict aborts the run.
+//-------------------------------------------------------------------
+#ifndef STRESS_MAX_THREADS
+#define STRESS_MAX_THREADS 8
+#endif
+#ifndef STRESS_DURATION_MS
+#define STRESS_DURATION_MS 2000
+#endif
+
+Validator sharedValidator;
+
+const char *payloads[] = {
+    "{\"ssid\":\"MyWiFi\",\"password\":\"StrongP@ss123\",\"channel\":6,\"gain\":0.5}",
+    "{\"ssid\":\"MyWiFi\",\"password\":\"weak\",\"channel\":6,\"gain\":0.5}",
+    "{\"ssid\":\"MyWiFi\",\"password\":\"StrongP@ss123\",\"channel\":42}",
+    "{\"password\":\"StrongP@ss123\"}",
+};
+const size_t payloadCount = sizeof(payloads) / sizeof(payloads[0]);
+bool expected[payloadCount];
+//___________________________________________________________________________________________
+unsigned long runWorkers(int threads)
+{
+    std::atomic<bool> stop{false};
+    std::atomic<bool> mismatch{false};
+    std::atomic<unsigned long> total{0};
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+                             {
+                                 DynamicJsonDocument docs[payloadCount] = {
+                                     DynamicJsonDocument(256), DynamicJsonDocument(256),
+                                     DynamicJsonDocument(256), DynamicJsonDocument(256)};
+                                 for (size_t i = 0; i < payloadCount; ++i)
+                                     deserializeJson(docs[i], payloads[i]);
+
+                                 unsigned long count = 0;
+                                 size_t i = t % payloadCount;
+                                 ValidationContext ctx;
+                                 while (!stop.load(std::memory_order_relaxed))
+                                 {
+                                     ctx.reset();
+                                     if (sharedValidator.isValid(docs[i].as<JsonVariant>(), ctx) != expected[i])
+                                         mismatch = true;
+                                     i = (i + 1) % payloadCount;
+                                     ++count;
+                                 }
+                                 total += count; });
+    }
+
+    delay(STRESS_DURATION_MS);
+    stop = true;
+    for (std::thread &worker : workers)
+        worker.join();
+
+    if (mismatch)
+    {
+        Serial.println("Concurrent verdict differs from single-threaded verdict ❌");
+        abort();
+    }
+    return total.load() * 1000UL / STRESS_DURATION_MS;
+}
+//___________________________________________________________________________________________
+void setup()
+{
+    Serial.begin(115200);
+    while (!Serial)
+        ;
+    //-------------------------------------------
+    sharedValidator.addField("ssid", FieldSchema().setType("string").setRequired(true).setLength(3, 32))
+        .addField("password", FieldSchema().setType("string").setRequired(true).setLength(8, 20).setPattern(PASSWORD_REGEX))
+        .addField("channel", FieldSchema().setType("integer").setValue(1, 13))
+        .addField("gain", FieldSchema().setType("float").setValue(0.0, 1.5));
+
+    DynamicJsonDocument doc(256);
+    for (size_t i = 0; i < payloadCount; ++i)
+    {
+        deserializeJson(doc, payloads[i]);
+        expected[i] = sharedValidator.isValid(doc.as<JsonVariant>());
+    }
+    //-------------------------------------------
+    unsigned long single = runWorkers(1);
+    Serial.printf("threads=1 validations/s=%lu scaling=1.00\n", single);
+    for (int threads = 2; threads <= STRESS_MAX_THREADS; threads *= 2)
+    {
+        unsigned long rate = runWorkers(threads);
+        Serial.printf("threads=%d validations/s=%lu scaling=%.2f\n", threads, rate, (float)rate / single);
+    }
+}
+//___________________________________________________________________________________________
+void loop() {}
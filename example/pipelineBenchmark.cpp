@@ -0,0 +1,347 @@
+#include <Arduino.h>
+#include <algorithm>
+#include <vector>
+#include "../src/PAT_dataValidator.h"
+#include "../src/PAT_APIConfig.h"
+#include "../src/PAT_AES.h"
+#include "../src/PAT_payloadGenerator.h"
+//___________________________________________________________________________________________
+// End-to-end request pipeline
+//
+// Replays generated payloads (PAT_payloadGenerator.h) through the stages a request passes on the device
+// and prints per-request latency percentiles and the heap high-water mark:
+//   route       method + url lookup in the route table
+//   permission  caller role against APIStruct::permissions
+//   headers     APIStruct::checkHeaders
+//   parse       deserializeJson into a document sized and filtered from the schema (bodyCapacity/bodyFilter)
+//   validate    Validator::isValid, which decrypts the AES-encrypted password into scratch (setEncrypted)
+// BENCH_INVALID_PERCENT of the requests carry one targeted fault each; a request whose verdict differs
+// from the generator's label is counted as a mismatch.
+//
+// Heap high-water is the most the heap grew above its level at the start of the run:
+//   ESP32  heap_caps free size and minimum free size; the minimum is reset for the run on ESP-IDF 5.1+,
+//          on older cores it is the minimum since boot and the figure is a lower bound
+//   host   (EpoxyDuino) counting operator new/delete and a counting JsonDocument allocator; String uses
+//          malloc and is not seen, the pipeline creates none per request
+// On a host the sketch also needs mbedtls (-lmbedcrypto) for PAT_AES.cpp and exits after the report.
+//-------------------------------------------------------------------
+#ifndef BENCH_REQUESTS
+#if defined(ESP_PLATFORM)
+#define BENCH_REQUESTS 5000
+#else
+#define BENCH_REQUESTS 200000
+#endif
+#endif
+#ifndef BENCH_CORPUS
+#if defined(ESP_PLATFORM)
+#define BENCH_CORPUS 48 // Distinct payloads, replayed in turn; bounded by RAM on the device
+#else
+#define BENCH_CORPUS 2048
+#endif
+#endif
+#ifndef BENCH_INVALID_PERCENT
+#define BENCH_INVALID_PERCENT 20
+#endif
+#ifndef BENCH_BODY_BYTES
+#define BENCH_BODY_BYTES 0 // Pad bodies to about this size with unknown keys; 0 = schema keys only
+#endif
+#ifndef BENCH_DEFAULT_CAPACITY
+#define BENCH_DEFAULT_CAPACITY 4096 // Document capacity when the schema does not bound the body
+#endif
+
+#if defined(ESP_PLATFORM)
+#include "esp_idf_version.h"
+#else
+#include <chrono>
+#include <new>
+#endif
+//___________________________________________________________________________________________
+// Clock and heap probes
+#if defined(ESP_PLATFORM)
+// CPU cycles; differences of two readings stay valid across the 32-bit wrap
+static inline uint32_t benchTicks()
+{
+    return ESP.getCycleCount();
+}
+
+static inline uint32_t ticksToNanos(uint64_t ticks)
+{
+    return (uint32_t)(ticks * 1000 / ESP.getCpuFreqMHz());
+}
+
+struct HeapProbe
+{
+    size_t before = 0;
+    void start()
+    {
+        before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+        heap_caps_monitor_local_minimum_free_size_start();
+#endif
+    }
+    size_t highWater()
+    {
+        size_t lowest = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+        heap_caps_monitor_local_minimum_free_size_stop();
+#endif
+        return before > lowest ? before - lowest : 0;
+    }
+};
+
+typedef DynamicJsonDocument BenchDocument;
+#else
+static inline uint32_t benchTicks()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint32_t ticksToNanos(uint64_t ticks)
+{
+    return (uint32_t)ticks;
+}
+
+static size_t heapInUse = 0, heapPeak = 0;
+
+static void *countedAlloc(size_t size)
+{
+    size_t *block = (size_t *)malloc(size + sizeof(max_align_t));
+    if (!block)
+        return nullptr;
+    *block = size;
+    heapInUse += size;
+    heapPeak = std::max(heapPeak, heapInUse);
+    return (char *)block + sizeof(max_align_t);
+}
+
+static void countedFree(void *p)
+{
+    if (!p)
+        return;
+    size_t *block = (size_t *)((char *)p - sizeof(max_align_t));
+    heapInUse -= *block;
+    free(block);
+}
+
+void *operator new(size_t size)
+{
+    void *p = countedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { countedFree(p); }
+void operator delete[](void *p) noexcept { countedFree(p); }
+void operator delete(void *p, size_t) noexcept { countedFree(p); }
+void operator delete[](void *p, size_t) noexcept { countedFree(p); }
+
+struct CountingAllocator
+{
+    void *allocate(size_t size) { return countedAlloc(size); }
+    void deallocate(void *p) { countedFree(p); }
+    void *reallocate(void *p, size_t size)
+    {
+        void *moved = countedAlloc(size);
+        if (moved && p)
+        {
+            size_t old = *(size_t *)((char *)p - sizeof(max_align_t));
+            memcpy(moved, p, std::min(old, size));
+            countedFree(p);
+        }
+        return moved;
+    }
+};
+
+struct HeapProbe
+{
+    size_t before = 0;
+    void start()
+    {
+        before = heapInUse;
+        heapPeak = heapInUse;
+    }
+    size_t highWater()
+    {
+        return heapPeak - before;
+    }
+};
+
+typedef BasicJsonDocument<CountingAllocator> BenchDocument;
+#endif
+//___________________________________________________________________________________________
+// Endpoints
+APIBuilder changePassword, readings, status;
+std::vector<APIStruct *> routes;
+
+const char *bearer = "Bearer 3f9a0c1d2e4b5a6978c0d1e2f3a4b5c6";
+
+void buildEndpoints()
+{
+    changePassword.setUrl("/api/Setting/password")
+        .setMethod("POST")
+        .setContentType("application/json")
+        .setPermission({"admin", "user"})
+        .setHeader("Authorization", FieldSchema().setType("string").setRequired(true).setPattern("^Bearer [0-9a-f]{32}$"))
+        .setHeader("X-Device-Id", "");
+
+    FieldSchema role = FieldSchema().setType("string").setRequired(true).setLength(4, 6).setPattern("^(admin|user|viewer)$");
+    FieldSchema user = FieldSchema().setType("string").setRequired(true).setLength(3, 32).setPattern("^[a-z][a-z0-9_.]+$");
+    FieldSchema password = FieldSchema().setType("string").setRequired(true).setLength(8, 32).setPattern("^[A-Za-z0-9!@#$%^&*]+$").setEncrypted(&aes);
+    FieldSchema pin = FieldSchema().setType("integer").setValue(0, 9999);
+    FieldSchema tags = FieldSchema().setType("array").setItems(0, 8);
+    changePassword.setBodyValidator("role", role)
+        .setBodyValidator("user", user)
+        .setBodyValidator("password", password)
+        .setBodyValidator("pin", pin)
+        .setBodyValidator("tags", tags);
+
+    readings.setUrl("/api/readings").setMethod("POST").setContentType("application/json").setPermission("admin");
+    status.setUrl("/api/status").setMethod("GET").setPermission({"admin", "user", "viewer"});
+
+    routes = {&readings.load(), &status.load(), &changePassword.load()};
+}
+
+const APIStruct *findRoute(const char *method, const char *url)
+{
+    for (const APIStruct *api : routes)
+    {
+        if (api->method == method && api->url == url)
+            return api;
+    }
+    return nullptr;
+}
+
+bool permitted(const APIStruct &api, const char *role)
+{
+    if (!api.hasPermissions)
+        return true;
+    for (const String &permission : api.permissions)
+    {
+        if (permission == role)
+            return true;
+    }
+    return false;
+}
+//___________________________________________________________________________________________
+struct StageTotals // ticks
+{
+    uint64_t route = 0, permission = 0, headers = 0, parse = 0, validate = 0;
+};
+
+// Nearest-rank percentile of sorted tick samples, in ns
+uint32_t percentile(const std::vector<uint32_t> &sorted, double p)
+{
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return ticksToNanos(sorted[std::min(index, sorted.size() - 1)]);
+}
+
+void runBenchmark()
+{
+    buildEndpoints();
+    const APIStruct &api = changePassword.load();
+
+    // Corpus: valid payloads plus one of each fault the schema can carry, in turn
+    PayloadGenerator generator(api, 12345);
+    generator.setEncryptor([](const String &plain)
+                           { return aes.encryptField(plain); })
+        .setTargetSize(BENCH_BODY_BYTES);
+    std::vector<PayloadGenerator::Payload> corpus;
+    std::vector<PayloadCase> faults;
+    for (int kind = (int)PayloadCase::ShortString; kind <= (int)PayloadCase::DeepNesting; ++kind)
+    {
+        PayloadGenerator::Payload probe;
+        if (generator.generate((PayloadCase)kind, probe))
+            faults.push_back((PayloadCase)kind);
+    }
+    for (size_t i = 0, fault = 0; i < BENCH_CORPUS; ++i)
+    {
+        bool invalid = !faults.empty() && (i * BENCH_INVALID_PERCENT) % 100 < BENCH_INVALID_PERCENT; // spread evenly
+        PayloadCase kind = invalid ? faults[fault++ % faults.size()] : (i % 4 == 0 ? PayloadCase::Boundary : PayloadCase::Valid);
+        PayloadGenerator::Payload payload;
+        if (generator.generate(kind, payload))
+            corpus.push_back(payload);
+    }
+    if (corpus.empty())
+    {
+        Serial.printf("No payloads could be generated.\n");
+        return;
+    }
+
+    size_t capacity = api.bodyCapacity();
+    if (capacity == 0)
+        capacity = BENCH_DEFAULT_CAPACITY;
+    DynamicJsonDocument filter(2048);
+    bool filtered = api.bodyFilter(filter);
+    HeaderView headers[] = {{"Content-Type", 12, "application/json; charset=utf-8", 31},
+                            {"Authorization", 13, bearer, strlen(bearer)},
+                            {"X-Device-Id", 11, "node-17", 7},
+                            {"Accept", 6, "*/*", 3}};
+
+    std::vector<uint32_t> latency;
+    latency.reserve(BENCH_REQUESTS);
+    StageTotals totals;
+    size_t accepted = 0, mismatches = 0;
+    HeapProbe heap;
+    heap.start();
+    //-------------------------------------------
+    for (size_t n = 0; n < BENCH_REQUESTS; ++n)
+    {
+        const PayloadGenerator::Payload &payload = corpus[n % corpus.size()];
+        uint32_t t0 = benchTicks();
+        const APIStruct *route = findRoute("POST", "/api/Setting/password");
+        uint32_t t1 = benchTicks();
+        bool ok = route && permitted(*route, "user");
+        uint32_t t2 = benchTicks();
+        ValidationContext ctx;
+        ok = ok && route->checkHeaders(headers, sizeof(headers) / sizeof(headers[0]), ctx);
+        uint32_t t3 = benchTicks(), t4 = t3;
+        if (ok)
+        {
+            BenchDocument doc(capacity);
+            DeserializationError error = filtered ? deserializeJson(doc, payload.body.c_str(), payload.body.length(), DeserializationOption::Filter(filter))
+                                                  : deserializeJson(doc, payload.body.c_str(), payload.body.length());
+            t4 = benchTicks();
+            ok = !error && route->bodyValid.isValid(doc.as<JsonVariant>(), ctx);
+        }
+        uint32_t t5 = benchTicks();
+
+        latency.push_back(t5 - t0);
+        totals.route += t1 - t0;
+        totals.permission += t2 - t1;
+        totals.headers += t3 - t2;
+        totals.parse += t4 - t3;
+        totals.validate += t5 - t4;
+        accepted += ok;
+        mismatches += ok != payload.valid;
+    }
+    //-------------------------------------------
+    size_t highWater = heap.highWater();
+    std::sort(latency.begin(), latency.end());
+    size_t bodyBytes = 0;
+    for (const PayloadGenerator::Payload &payload : corpus)
+        bodyBytes += payload.body.length();
+
+    Serial.printf("%u requests, %u distinct bodies (mean %u B), %u fault kinds, capacity %u B%s\n", (unsigned)BENCH_REQUESTS,
+                  (unsigned)corpus.size(), (unsigned)(bodyBytes / corpus.size()), (unsigned)faults.size(), (unsigned)capacity, filtered ? ", filtered" : "");
+    Serial.printf("accepted %u, rejected %u, label mismatches %u\n", (unsigned)accepted, (unsigned)(BENCH_REQUESTS - accepted), (unsigned)mismatches);
+    Serial.printf("latency ns  p50 %u | p99 %u | p99.9 %u | max %u\n", percentile(latency, 0.50), percentile(latency, 0.99),
+                  percentile(latency, 0.999), ticksToNanos(latency.back()));
+    Serial.printf("mean ns     route %u | permission %u | headers %u | parse %u | validate+decrypt %u\n",
+                  ticksToNanos(totals.route / BENCH_REQUESTS), ticksToNanos(totals.permission / BENCH_REQUESTS), ticksToNanos(totals.headers / BENCH_REQUESTS),
+                  ticksToNanos(totals.parse / BENCH_REQUESTS), ticksToNanos(totals.validate / BENCH_REQUESTS));
+    Serial.printf("heap high-water %u B\n", (unsigned)highWater);
+}
+//___________________________________________________________________________________________
+void setup()
+{
+    Serial.begin(115200);
+    while (!Serial)
+        ;
+    runBenchmark();
+#if !defined(ESP_PLATFORM)
+    exit(0);
+#endif
+}
+//___________________________________________________________________________________________
+void loop() {}
@@ -20,6 +20,7 @@ AESLibrary::AESLibrary(const uint8_t *key, const uint8_t *iv)
   // Copy the key and IV into the class variables
   memcpy(this->aes_key, key, 16); // AES-128 uses a 128-bit key (16 bytes)
   memcpy(this->iv, iv, 16);       // IV should also be 16 bytes
+  memcpy(this->config_iv, iv, 16);
 
   // Initialize AES context
   mbedtls_aes_init(&aes);
@@ -73,6 +74,91 @@ String AESLibrary::decrypt(String ciphertext)
   return decryptedText;
 }
 //___________________________________________________________________________________________________
+int AESLibrary::decrypt(const char *ciphertext, size_t length, uint8_t *out, size_t capacity) const
+{
+  size_t size = length / 2;
+  if (length % 2 || size == 0 || size % 16 || size > capacity)
+    return -1;
+  for (size_t i = 0; i < size; i++)
+  {
+    int high = hexValue(ciphertext[2 * i]);
+    int low = hexValue(ciphertext[2 * i + 1]);
+    if (high < 0 || low < 0)
+      return -1;
+    out[i] = (uint8_t)((high << 4) | low);
+  }
+
+  mbedtls_aes_context context; // Per call: the member context is not safe to share between tasks
+  uint8_t chain[16];
+  memcpy(chain, config_iv, 16);
+  mbedtls_aes_init(&context);
+  int status = mbedtls_aes_setkey_dec(&context, aes_key, 128);
+  if (status == 0)
+    status = mbedtls_aes_crypt_cbc(&context, MBEDTLS_AES_DECRYPT, size, chain, out, out); // in place
+  mbedtls_aes_free(&context);
+  if (status != 0)
+    return -1;
+
+  // PKCS7 padding: 1..16 bytes, all equal to the padding length
+  uint8_t padding = out[size - 1];
+  if (padding == 0 || padding > 16)
+    return -1;
+  for (size_t i = 1; i <= padding; i++)
+  {
+    if (out[size - i] != padding)
+      return -1;
+  }
+  return (int)(size - padding);
+}
+//___________________________________________________________________________________________________
+String AESLibrary::encryptField(const String &plaintext) const
+{
+  size_t length = plaintext.length();
+  size_t paddedLength = length + (16 - (length % 16)); // PKCS7: always 1..16 bytes of padding
+  uint8_t buffer[paddedLength];
+  memcpy(buffer, plaintext.c_str(), length);
+  memset(buffer + length, (int)(paddedLength - length), paddedLength - length);
+
+  mbedtls_aes_context context;
+  uint8_t chain[16];
+  memcpy(chain, config_iv, 16);
+  mbedtls_aes_init(&context);
+  int status = mbedtls_aes_setkey_enc(&context, aes_key, 128);
+  if (status == 0)
+    status = mbedtls_aes_crypt_cbc(&context, MBEDTLS_AES_ENCRYPT, paddedLength, chain, buffer, buffer);
+  mbedtls_aes_free(&context);
+  String hex = status == 0 ? bytesToHex(buffer, paddedLength) : String();
+  wipe(buffer, paddedLength);
+  return hex;
+}
+//___________________________________________________________________________________________________
+bool AESLibrary::decryptField(const String &ciphertext, String &plaintext) const
+{
+  size_t capacity = ciphertext.length() / 2 + 1;
+  uint8_t buffer[capacity];
+  int length = decrypt(ciphertext.c_str(), ciphertext.length(), buffer, capacity);
+  if (length >= 0)
+  {
+    plaintext = "";
+    plaintext.reserve(length);
+    for (int i = 0; i < length; i++)
+      plaintext += (char)buffer[i];
+  }
+  wipe(buffer, capacity);
+  return length >= 0;
+}
+//___________________________________________________________________________________________________
+int AESLibrary::hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+//___________________________________________________________________________________________________
 // Convert hex string to byte array
 void AESLibrary::hexToBytes(const String &hex, uint8_t *bytes, size_t len)
 {
@@ -5,21 +5,32 @@
 #include <mbedtls/aes.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
+#include "PAT_fieldCipher.h"
 
-class AESLibrary
+class AESLibrary : public FieldCipher
 {
 public:
   AESLibrary(const uint8_t *key, const uint8_t *iv);
   String encrypt(String plaintext);
   String decrypt(String ciphertext);
+  // Hex ciphertext into `out` without allocating; -1 on bad hex, length or padding. Uses its own AES
+  // context and the IV as configured (encrypt/decrypt(String) chain theirs from call to call), so
+  // FieldSchema::setEncrypted fields can be validated from several tasks at once.
+  int decrypt(const char *ciphertext, size_t length, uint8_t *out, size_t capacity) const override;
+  // Field values, with the same IV rule as the decrypt() above: each value starts from the configured IV,
+  // so a handler gets back exactly the plaintext FieldSchema::setEncrypted validated. Safe from any task.
+  String encryptField(const String &plaintext) const;
+  bool decryptField(const String &ciphertext, String &plaintext) const; // false when decrypt() fails
 
 private:
   mbedtls_aes_context aes;
   uint8_t aes_key[16]; // 128-bit key (16 bytes)
   uint8_t iv[16];      // Initialization Vector (16 bytes)
+  uint8_t config_iv[16]; // IV as passed to the constructor; CBC updates `iv` on every String call
 
   void hexToBytes(const String &hex, uint8_t *bytes, size_t len);
-  String bytesToHex(uint8_t *bytes, size_t len);
+  static int hexValue(char c);
+  static String bytesToHex(uint8_t *bytes, size_t len);
 };
 
 #endif // PAT_AES
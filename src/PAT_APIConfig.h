@@ -6,6 +6,7 @@
 #include <iostream>
 #include "PAT_regexConfig.h"
 #include "PAT_dataValidator.h"
+#include "PAT_headerMatcher.h"
 
 //===========================================================================================================================================
 struct APIStruct
@@ -23,6 +24,49 @@ struct APIStruct
     std::vector<std::pair<String, String>> headers;
     Validator bodyValid;
     Validator bodyArrayValid;
+    HeaderMatcher headerRules; // Compiled from setHeader/setContentType
+
+    // One pass over the request headers (HeaderView array, or name/value pairs); see PAT_headerMatcher.h
+    bool checkHeaders(const HeaderView *incoming, size_t count, ValidationContext &ctx) const
+    {
+        return headerRules.check(incoming, count, ctx);
+    }
+
+    template <typename Headers>
+    bool checkHeaders(const Headers &incoming, ValidationContext &ctx) const
+    {
+        return headerRules.check(incoming, ctx);
+    }
+
+    // More headers were set than HEADER_MATCHER_MAX_RULES; checkHeaders then rejects every request
+    bool hasTooManyHeaders() const
+    {
+        return headerRules.hasTooManyRules();
+    }
+
+    // Capacity for the request body (see Validator::documentCapacity); an array body may hold up to
+    // `maxElements` objects. 0 when the schemas do not bound it.
+    size_t bodyCapacity(size_t maxElements = 0) const
+    {
+        size_t capacity = hasValidator ? bodyValid.documentCapacity() : 0;
+        if (hasArrayValidator)
+        {
+            size_t array = bodyArrayValid.arrayCapacity(maxElements);
+            if (array == 0 || (hasValidator && capacity == 0))
+                return 0;
+            capacity = std::max(capacity, array);
+        }
+        return capacity;
+    }
+
+    // Deserialisation filter for the body; false when the endpoint accepts both an object and an array
+    // body, or its validator cannot be filtered (see Validator::buildFilter).
+    bool bodyFilter(JsonDocument &filter) const
+    {
+        if (hasValidator == hasArrayValidator)
+            return false;
+        return hasValidator ? bodyValid.buildFilter(filter) : bodyArrayValid.buildFilter(filter, true);
+    }
 };
 
 class APIBuilder
@@ -31,7 +75,7 @@ private:
     APIStruct api;
 
 public:
-    APIBuilder() : api{false, false, false, false, false, "", "", "", "", {}, {}, Validator()} {}
+    APIBuilder() : api{false, false, false, false, false, "", "", "", "", {}, {}, Validator(), Validator(), HeaderMatcher()} {}
     APIStruct &load()
     {
         return api;
@@ -41,6 +85,12 @@ public:
         return api;
     }
 
+    // See APIStruct::hasTooManyHeaders
+    bool hasTooManyHeaders() const
+    {
+        return api.hasTooManyHeaders();
+    }
+
     APIBuilder &logOn(String name)
     {
         api.logOn = true;
@@ -62,18 +112,30 @@ public:
     APIBuilder &setContentType(const String &ct)
     {
         api.contentType = ct;
+        api.headerRules.requireContentType(ct);
         return *this;
     }
 
+    // Required header; an empty value only checks presence
     APIBuilder &setHeader(String headerName, String headerValue)
     {
         api.headers.push_back(std::make_pair(headerName, headerValue));
+        api.headerRules.require(headerName, headerValue);
         return *this;
     }
 
     APIBuilder &setHeader(const std::initializer_list<std::pair<String, String>> &headerList)
     {
         api.headers.insert(api.headers.end(), headerList);
+        for (const auto &header : headerList)
+            api.headerRules.require(header.first, header.second);
+        return *this;
+    }
+
+    // Header whose value must pass a FieldSchema (token formats, numeric limits); required if the schema is
+    APIBuilder &setHeader(const String &headerName, const FieldSchema &valueSchema)
+    {
+        api.headerRules.add(headerName, valueSchema);
         return *this;
     }
 
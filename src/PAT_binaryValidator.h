@@ -0,0 +1,549 @@
+#ifndef PAT_binaryValidator_H
+#define PAT_binaryValidator_H
+#include <Arduino.h>
+#include <climits>
+#include <cmath>
+#include "PAT_dataValidator.h"
+
+//===========================================================================================================================================
+// MessagePack / CBOR validation
+//
+// Runs a Validator's compiled FieldSchema rules directly on a MessagePack or CBOR byte stream, with no
+// JsonDocument in between. Strings, byte strings and arrays are judged from their length prefix: a
+// string that is too long is rejected without reading its bytes, and values of keys the schema does not
+// know are skipped by length. Only regex checks read string contents.
+//
+//   if (BinaryValidator::isValidMsgPack(sensorValidator, payload, payloadLength))
+//       deserializeMsgPack(doc, payload, payloadLength);
+//
+// Semantics match Validator::isValid / isArrayValid on the equivalent JSON. In addition the binary
+// path fails closed on: duplicate schema keys in one map (strict validators: any unknown key), non-string map keys, trailing bytes after the
+// document, CBOR indefinite-length items and reserved encodings. Every map is walked with the member
+// bitmap, so a schema with more than VALIDATOR_MAX_KEYS keys fails with TooManyKeys. Normalisation
+// (setTrim, setCase, setClamp, setDefault) needs a document to write to: here values are checked as sent,
+// so one that would only pass once trimmed or clamped is rejected.
+//-------------------------------------------------------------------
+enum class BinaryKind : uint8_t
+{
+    Nil,
+    Bool,
+    Int,
+    Float,
+    String,
+    Bytes,
+    Array,
+    Map,
+};
+
+struct BinaryItem
+{
+    BinaryKind kind;
+    bool boolean;
+    bool overflow;  // Integer does not fit int64_t
+    int64_t integer;
+    double number;
+    const char *data; // String/Bytes payload, not NUL-terminated
+    uint32_t length;  // Bytes for String/Bytes, entries for Array/Map
+};
+//-------------------------------------------------------------------
+// Stream readers: next() decodes one header and leaves the reader on the first child of an Array/Map.
+//-------------------------------------------------------------------
+class BinaryReaderBase
+{
+public:
+    BinaryReaderBase(const uint8_t *data, size_t size) : p_(data), end_(data + size) {}
+    bool atEnd() const { return p_ == end_; }
+    size_t remaining() const { return end_ - p_; }
+
+protected:
+    const uint8_t *p_;
+    const uint8_t *end_;
+
+    bool readBE(size_t bytes, uint64_t &out)
+    {
+        if (remaining() < bytes)
+            return false;
+        out = 0;
+        for (size_t i = 0; i < bytes; ++i)
+            out = (out << 8) | p_[i];
+        p_ += bytes;
+        return true;
+    }
+
+    // Payload is skipped, never read; an Array/Map cannot hold more entries than bytes remain.
+    bool take(BinaryItem &item, BinaryKind kind, uint64_t length)
+    {
+        item.kind = kind;
+        if (length > UINT32_MAX || length > remaining())
+            return false;
+        item.length = (uint32_t)length;
+        if (kind == BinaryKind::String || kind == BinaryKind::Bytes)
+        {
+            item.data = reinterpret_cast<const char *>(p_);
+            p_ += length;
+        }
+        return true;
+    }
+
+    static void setInteger(BinaryItem &item, uint64_t magnitude, bool negative)
+    {
+        item.kind = BinaryKind::Int;
+        item.overflow = magnitude > (uint64_t)INT64_MAX;
+        item.integer = negative ? -1 - (int64_t)(magnitude & INT64_MAX) : (int64_t)(magnitude & INT64_MAX);
+    }
+
+    static double fromBits32(uint64_t bits)
+    {
+        uint32_t b = (uint32_t)bits;
+        float f;
+        memcpy(&f, &b, sizeof(f));
+        return f;
+    }
+
+    static double fromBits64(uint64_t bits)
+    {
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+};
+
+class MsgPackReader : public BinaryReaderBase
+{
+public:
+    using BinaryReaderBase::BinaryReaderBase;
+
+    bool next(BinaryItem &item)
+    {
+        memset(&item, 0, sizeof(item));
+        if (atEnd())
+            return false;
+        uint8_t b = *p_++;
+        uint64_t v;
+
+        if (b <= 0x7f || b >= 0xe0)
+        {
+            item.kind = BinaryKind::Int;
+            item.integer = (int8_t)b; // positive and negative fixint
+            return true;
+        }
+        if (b <= 0x8f)
+            return take(item, BinaryKind::Map, b & 0x0f);
+        if (b <= 0x9f)
+            return take(item, BinaryKind::Array, b & 0x0f);
+        if (b <= 0xbf)
+            return take(item, BinaryKind::String, b & 0x1f);
+
+        switch (b)
+        {
+        case 0xc0:
+            item.kind = BinaryKind::Nil;
+            return true;
+        case 0xc2:
+        case 0xc3:
+            item.kind = BinaryKind::Bool;
+            item.boolean = b == 0xc3;
+            return true;
+        case 0xc4:
+        case 0xc5:
+        case 0xc6:
+            return readBE(1 << (b - 0xc4), v) && take(item, BinaryKind::Bytes, v);
+        case 0xc7:
+        case 0xc8:
+        case 0xc9:
+        {
+            uint64_t extType; // ext 8/16/32: length, type byte, data
+            return readBE(1 << (b - 0xc7), v) && readBE(1, extType) && take(item, BinaryKind::Bytes, v);
+        }
+        case 0xca:
+        case 0xcb:
+            if (!readBE(b == 0xca ? 4 : 8, v))
+                return false;
+            item.kind = BinaryKind::Float;
+            item.number = b == 0xca ? fromBits32(v) : fromBits64(v);
+            return true;
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf:
+            if (!readBE(1 << (b - 0xcc), v))
+                return false;
+            setInteger(item, v, false);
+            return true;
+        case 0xd0:
+        case 0xd1:
+        case 0xd2:
+        case 0xd3:
+            return readSigned(1 << (b - 0xd0), item);
+        case 0xd4:
+        case 0xd5:
+        case 0xd6:
+        case 0xd7:
+        case 0xd8:
+            return readBE(1, v) && take(item, BinaryKind::Bytes, 1 << (b - 0xd4)); // fixext: type byte + data
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            return readBE(1 << (b - 0xd9), v) && take(item, BinaryKind::String, v);
+        case 0xdc:
+        case 0xdd:
+            return readBE(2 << (b - 0xdc), v) && take(item, BinaryKind::Array, v);
+        case 0xde:
+        case 0xdf:
+            return readBE(2 << (b - 0xde), v) && take(item, BinaryKind::Map, v);
+        default:
+            return false; // 0xc1 is never used
+        }
+    }
+
+private:
+    bool readSigned(size_t bytes, BinaryItem &item)
+    {
+        uint64_t v;
+        if (!readBE(bytes, v))
+            return false;
+        int shift = 64 - 8 * bytes;
+        item.kind = BinaryKind::Int;
+        item.integer = (int64_t)(v << shift) >> shift;
+        return true;
+    }
+};
+
+class CborReader : public BinaryReaderBase
+{
+public:
+    using BinaryReaderBase::BinaryReaderBase;
+
+    bool next(BinaryItem &item)
+    {
+        memset(&item, 0, sizeof(item));
+        for (;;)
+        {
+            if (atEnd())
+                return false;
+            uint8_t b = *p_++;
+            uint8_t major = b >> 5;
+            uint8_t info = b & 0x1f;
+            uint64_t arg;
+
+            if (info < 24)
+                arg = info;
+            else if (info <= 27)
+            {
+                if (!readBE(1 << (info - 24), arg))
+                    return false;
+            }
+            else
+                return false; // reserved or indefinite length
+
+            switch (major)
+            {
+            case 0:
+                setInteger(item, arg, false);
+                return true;
+            case 1:
+                setInteger(item, arg, true);
+                return true;
+            case 2:
+                return take(item, BinaryKind::Bytes, arg);
+            case 3:
+                return take(item, BinaryKind::String, arg);
+            case 4:
+                return take(item, BinaryKind::Array, arg);
+            case 5:
+                return take(item, BinaryKind::Map, arg);
+            case 6:
+                continue; // tags annotate the next item, validate the item itself
+            default:
+                return simple(info, arg, item);
+            }
+        }
+    }
+
+private:
+    static bool simple(uint8_t info, uint64_t arg, BinaryItem &item)
+    {
+        switch (info)
+        {
+        case 20:
+        case 21:
+            item.kind = BinaryKind::Bool;
+            item.boolean = info == 21;
+            return true;
+        case 22:
+        case 23:
+            item.kind = BinaryKind::Nil;
+            return true;
+        case 25:
+            item.kind = BinaryKind::Float;
+            item.number = fromHalf((uint16_t)arg);
+            return true;
+        case 26:
+            item.kind = BinaryKind::Float;
+            item.number = fromBits32(arg);
+            return true;
+        case 27:
+            item.kind = BinaryKind::Float;
+            item.number = fromBits64(arg);
+            return true;
+        default:
+            return false; // unassigned simple values
+        }
+    }
+
+    static double fromHalf(uint16_t half)
+    {
+        int exponent = (half >> 10) & 0x1f;
+        int mantissa = half & 0x3ff;
+        double value;
+        if (exponent == 0)
+            value = ldexp(mantissa, -24);
+        else if (exponent != 31)
+            value = ldexp(mantissa + 1024, exponent - 25);
+        else
+            value = mantissa == 0 ? INFINITY : NAN;
+        return (half & 0x8000) ? -value : value;
+    }
+};
+//-------------------------------------------------------------------
+// Validator walk over a reader
+//-------------------------------------------------------------------
+class BinaryValidator
+{
+public:
+    //----------------------------------------------
+    static bool isValidMsgPack(const Validator &validator, const uint8_t *data, size_t size)
+    {
+        ValidationContext ctx;
+        return isValidMsgPack(validator, data, size, ctx);
+    }
+    static bool isValidMsgPack(const Validator &validator, const uint8_t *data, size_t size, ValidationContext &ctx)
+    {
+        MsgPackReader reader(data, size);
+        return validateDocument(validator, reader, false, ctx);
+    }
+    static bool isArrayValidMsgPack(const Validator &validator, const uint8_t *data, size_t size, ValidationContext &ctx)
+    {
+        MsgPackReader reader(data, size);
+        return validateDocument(validator, reader, true, ctx);
+    }
+    //----------------------------------------------
+    static bool isValidCbor(const Validator &validator, const uint8_t *data, size_t size)
+    {
+        ValidationContext ctx;
+        return isValidCbor(validator, data, size, ctx);
+    }
+    static bool isValidCbor(const Validator &validator, const uint8_t *data, size_t size, ValidationContext &ctx)
+    {
+        CborReader reader(data, size);
+        return validateDocument(validator, reader, false, ctx);
+    }
+    static bool isArrayValidCbor(const Validator &validator, const uint8_t *data, size_t size, ValidationContext &ctx)
+    {
+        CborReader reader(data, size);
+        return validateDocument(validator, reader, true, ctx);
+    }
+    //----------------------------------------------
+    // Apply the schemas of one key (merged when the validator folded them) to a decoded header
+    static bool validateKey(const Validator &validator, const Validator::KeyEntry &entry, const BinaryItem &item, ValidationContext &ctx)
+    {
+        if (const MergedField *merged = validator.mergedField(entry))
+            return validateItem(merged->rules, merged->patterns(), item, ctx);
+        for (const FieldSchema &schema : *entry.schemas)
+        {
+            if (schema.hasPatternError())
+                return ctx.fail(ValidationError::PatternInvalid);
+            uint32_t budget = FieldSchema::stepBudget(schema.getRules());
+            PatternSet patterns = {schema.getPatternProgram(), &budget, schema.getRules().has(FieldRules::Pattern) ? 1u : 0u};
+            if (!validateItem(schema.getRules(), patterns, item, ctx, schema.getCipher()))
+                return false;
+        }
+        return true;
+    }
+
+    // Apply one set of rules to a decoded header. Does not consume Array/Map children.
+    static bool validateItem(const FieldRules &rules, const PatternSet &patterns, const BinaryItem &item, ValidationContext &ctx, const FieldCipher *cipher = nullptr)
+    {
+        ++ctx.fieldsChecked;
+        switch (rules.type)
+        {
+        case FieldType::Boolean:
+            return item.kind == BinaryKind::Bool || ctx.fail(ValidationError::WrongType);
+        case FieldType::Integer:
+            if (item.kind != BinaryKind::Int || item.overflow || item.integer < INT_MIN || item.integer > INT_MAX)
+                return ctx.fail(ValidationError::WrongType);
+            return FieldSchema::checkInteger(rules, (int)item.integer, ctx);
+        case FieldType::Float:
+            if (item.kind == BinaryKind::Int)
+                return FieldSchema::checkFloat(rules, item.overflow ? (float)(uint64_t)item.integer : (float)item.integer, ctx);
+            if (item.kind != BinaryKind::Float)
+                return ctx.fail(ValidationError::WrongType);
+            return FieldSchema::checkFloat(rules, (float)item.number, ctx);
+        case FieldType::String:
+            if (item.kind != BinaryKind::String)
+                return ctx.fail(ValidationError::WrongType);
+            if (cipher)
+                return FieldSchema::checkEncrypted(rules, patterns, *cipher, item.data, item.length, ctx);
+            return FieldSchema::checkString(rules, patterns, item.data, item.length, ctx);
+        case FieldType::Array:
+            if (item.kind != BinaryKind::Array)
+                return ctx.fail(ValidationError::WrongType);
+            return FieldSchema::checkItems(rules, item.length, ctx);
+        default:
+            return ctx.fail(ValidationError::WrongType);
+        }
+    }
+    //----------------------------------------------
+    // Skip the children of an Array/Map header; string payloads are stepped over by length.
+    template <typename Reader>
+    static bool skipChildren(Reader &reader, const BinaryItem &item)
+    {
+        uint64_t pending = childCount(item);
+        BinaryItem child;
+        while (pending)
+        {
+            if (!reader.next(child))
+                return false;
+            --pending;
+            pending += childCount(child);
+        }
+        return true;
+    }
+    //----------------------------------------------
+private:
+    static uint64_t childCount(const BinaryItem &item)
+    {
+        if (item.kind == BinaryKind::Array)
+            return item.length;
+        if (item.kind == BinaryKind::Map)
+            return (uint64_t)item.length * 2;
+        return 0;
+    }
+
+    template <typename Reader>
+    static bool validateDocument(const Validator &validator, Reader &reader, bool arrayOfObjects, ValidationContext &ctx)
+    {
+        ctx.logger = nullptr;
+        BinaryItem root;
+        if (!reader.next(root))
+            return ctx.fail(ValidationError::WrongType);
+
+        if (arrayOfObjects)
+        {
+            if (root.kind != BinaryKind::Array)
+                return ctx.fail(ValidationError::WrongType);
+            for (uint32_t i = 0; i < root.length; ++i)
+            {
+                BinaryItem element;
+                if (!reader.next(element))
+                    return ctx.fail(ValidationError::WrongType);
+                if (!validateObject(validator, reader, element, ctx))
+                    return false;
+            }
+        }
+        else if (!validateObject(validator, reader, root, ctx))
+            return false;
+
+        return reader.atEnd() || ctx.fail(ValidationError::WrongType);
+    }
+
+    // `root` has been decoded; consumes its children.
+    template <typename Reader>
+    static bool validateObject(const Validator &validator, Reader &reader, const BinaryItem &root, ValidationContext &ctx)
+    {
+        const std::vector<Validator::KeyEntry> &keys = validator.keys();
+        if (keys.size() > VALIDATOR_MAX_KEYS)
+            return ctx.fail(ValidationError::TooManyKeys); // the walk could not track every schema key
+
+        uint32_t seen[(VALIDATOR_MAX_KEYS + 31) / 32] = {0};
+        const Validator::KeyEntry *document = validator.findKey("", 0);
+        CapturedValue captured[VALIDATOR_MAX_CROSS_KEYS];
+        memset(captured, 0, sizeof(captured));
+
+        if (root.kind == BinaryKind::Map)
+        {
+            if (validator.maxKeys() && root.length > validator.maxKeys())
+                return ctx.fail(ValidationError::TooManyKeys); // known from the length prefix alone
+            for (uint32_t i = 0; i < root.length; ++i)
+            {
+                BinaryItem key, value;
+                if (!reader.next(key) || key.kind != BinaryKind::String)
+                    return ctx.fail(ValidationError::WrongType);
+                // A "" key is a member like any other, not the whole-document entry
+                const Validator::KeyEntry *entry = key.length ? validator.findKey(key.data, key.length) : nullptr;
+                if (!reader.next(value))
+                    return ctx.fail(ValidationError::WrongType);
+
+                if (entry != nullptr)
+                {
+                    size_t index = entry - keys.data();
+                    ctx.field = entry->name;
+                    if (seen[index / 32] & (1UL << (index % 32)))
+                        return ctx.fail(ValidationError::UnknownKey); // duplicate key, as on the JSON path
+                    seen[index / 32] |= 1UL << (index % 32);
+
+                    if (!validateKey(validator, *entry, value, ctx))
+                        return false;
+                    if (entry->capture >= 0)
+                        captured[entry->capture] = capture(value);
+                }
+                else if (validator.isStrict())
+                    return ctx.fail(ValidationError::UnknownKey);
+                if (!skipChildren(reader, value))
+                    return ctx.fail(ValidationError::WrongType);
+            }
+        }
+        else if (!skipChildren(reader, root))
+            return ctx.fail(ValidationError::WrongType);
+
+        for (size_t index = 0; index < keys.size(); ++index)
+        {
+            const Validator::KeyEntry &entry = keys[index];
+            if (seen[index / 32] & (1UL << (index % 32)))
+                continue;
+            ctx.field = entry.name;
+            if (&entry == document)
+            {
+                // Whole-document rules apply to the root itself
+                if (!validateKey(validator, entry, root, ctx))
+                    return false;
+            }
+            else if (entry.required)
+                return ctx.fail(ValidationError::MissingRequired);
+        }
+        return !validator.hasCrossFieldRules() || validator.checkCrossFields(captured, ctx);
+    }
+
+    static CapturedValue capture(const BinaryItem &item)
+    {
+        CapturedValue c = {CapturedValue::Other, 0.0, nullptr, 0};
+        switch (item.kind)
+        {
+        case BinaryKind::Nil:
+            c.kind = CapturedValue::Null;
+            break;
+        case BinaryKind::Bool:
+            c.kind = CapturedValue::Bool;
+            c.number = item.boolean ? 1.0 : 0.0;
+            break;
+        case BinaryKind::Int:
+            c.kind = CapturedValue::Number;
+            c.number = item.overflow ? (double)(uint64_t)item.integer : (double)item.integer;
+            break;
+        case BinaryKind::Float:
+            c.kind = CapturedValue::Number;
+            c.number = item.number;
+            break;
+        case BinaryKind::String:
+            c.kind = CapturedValue::String;
+            c.str = item.data;
+            c.length = item.length;
+            break;
+        default:
+            break;
+        }
+        return c;
+    }
+};
+
+#endif // PAT_binaryValidator_H
@@ -0,0 +1,183 @@
+#ifndef PAT_boundValidator_H
+#define PAT_boundValidator_H
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <vector>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#include "PAT_dataValidator.h"
+
+//===========================================================================================================================================
+// Validate-and-bind
+//
+// Ties schema keys to members of a plain C++ struct. The validator's walk hands each value that passed
+// its schemas to the binding, which stores it in the struct on the spot, so there is no second lookup
+// and no String copy:
+//
+//   struct WifiConfig { char ssid[33]; int channel; float gain; bool hidden; };
+//
+//   BoundValidator<WifiConfig> wifiBinding(wifiValidator);
+//   wifiBinding.bind("ssid", &WifiConfig::ssid).bind("channel", &WifiConfig::channel)
+//              .bind("gain", &WifiConfig::gain).bind("hidden", &WifiConfig::hidden);
+//
+//   WifiConfig config = {};                  // members of keys left out keep their value, or get the default
+//   if (wifiBinding.isValid(doc.as<JsonVariant>(), config))
+//       apply(config);
+//
+// Char buffers receive a NUL-terminated copy and reject strings that do not fit. std::string_view members
+// (C++17) point into the JsonDocument and are only valid while it is. On failure the struct may be
+// partially written. Keys are resolved once when bound, so the Validator must be complete before binding
+// and must outlive the BoundValidator. Like a Validator, a built BoundValidator can be shared by tasks.
+//-------------------------------------------------------------------
+template <typename T>
+class BoundValidator
+{
+public:
+    explicit BoundValidator(const Validator &validator) : validator_(validator), setters_(validator.keys().size()) {}
+    //----------------------------------------------
+    BoundValidator &bind(const char *key, int T::*member)
+    {
+        return add(key, [member](T &out, const JsonVariant &value)
+                   {
+                       if (!value.is<int>())
+                           return ValidationError::WrongType;
+                       out.*member = value.as<int>();
+                       return ValidationError::None; });
+    }
+
+    BoundValidator &bind(const char *key, float T::*member)
+    {
+        return add(key, [member](T &out, const JsonVariant &value)
+                   {
+                       if (!value.is<float>())
+                           return ValidationError::WrongType;
+                       out.*member = value.as<float>();
+                       return ValidationError::None; });
+    }
+
+    BoundValidator &bind(const char *key, bool T::*member)
+    {
+        return add(key, [member](T &out, const JsonVariant &value)
+                   {
+                       if (!value.is<bool>())
+                           return ValidationError::WrongType;
+                       out.*member = value.as<bool>();
+                       return ValidationError::None; });
+    }
+
+    template <size_t N>
+    BoundValidator &bind(const char *key, char (T::*member)[N])
+    {
+        return add(key, [member](T &out, const JsonVariant &value)
+                   {
+                       const char *str = value.as<const char *>();
+                       if (str == nullptr)
+                           return ValidationError::WrongType;
+                       size_t length = strlen(str);
+                       if (length >= N)
+                           return ValidationError::LengthOutOfRange;
+                       memcpy(out.*member, str, length + 1);
+                       return ValidationError::None; });
+    }
+
+#if __cplusplus >= 201703L
+    BoundValidator &bind(const char *key, std::string_view T::*member)
+    {
+        return add(key, [member](T &out, const JsonVariant &value)
+                   {
+                       const char *str = value.as<const char *>();
+                       if (str == nullptr)
+                           return ValidationError::WrongType;
+                       out.*member = std::string_view(str);
+                       return ValidationError::None; });
+    }
+#endif
+    //----------------------------------------------
+    bool isValid(const JsonVariant &json, T &out) const
+    {
+        ValidationContext ctx;
+        return isValid(json, out, ctx);
+    }
+
+    bool isValid(const JsonVariant &json, T &out, ValidationContext &ctx) const
+    {
+        if (!unresolved_.isEmpty())
+        {
+            ctx.field = unresolved_.c_str();
+            return ctx.fail(ValidationError::UnknownKey); // bound to a key the schema does not have
+        }
+        Target target(*this, out);
+        const ValueSink *previous = ctx.sink;
+        ctx.sink = &target;
+        bool valid = validator_.isValid(json, ctx);
+        ctx.sink = previous;
+        return valid;
+    }
+    //----------------------------------------------
+    // Validates an array of objects into out[0..capacity); `count` receives the number of elements.
+    bool isArrayValid(const JsonVariant &arrays, T *out, size_t capacity, size_t &count) const
+    {
+        ValidationContext ctx;
+        return isArrayValid(arrays, out, capacity, count, ctx);
+    }
+
+    bool isArrayValid(const JsonVariant &arrays, T *out, size_t capacity, size_t &count, ValidationContext &ctx) const
+    {
+        count = 0;
+        if (!arrays.is<JsonArray>())
+            return ctx.fail(ValidationError::WrongType);
+        for (const JsonVariant &item : arrays.as<JsonArray>())
+        {
+            if (count == capacity)
+                return ctx.fail(ValidationError::ItemsOutOfRange);
+            if (!isValid(item, out[count], ctx))
+                return false;
+            ++count;
+        }
+        return true;
+    }
+    //----------------------------------------------
+private:
+    typedef std::function<ValidationError(T &, const JsonVariant &)> Setter;
+
+    // Per-call sink: carries the output struct so the BoundValidator itself stays read-only
+    class Target : public ValueSink
+    {
+    public:
+        Target(const BoundValidator &binding, T &out) : binding_(binding), out_(out) {}
+
+        bool accept(size_t keyIndex, const JsonVariant &value, ValidationContext &ctx) const override
+        {
+            const Setter &setter = binding_.setters_[keyIndex];
+            if (!setter)
+                return true;
+            ValidationError error = setter(out_, value);
+            return error == ValidationError::None || ctx.fail(error);
+        }
+
+    private:
+        const BoundValidator &binding_;
+        T &out_;
+    };
+
+    const Validator &validator_;
+    std::vector<Setter> setters_; // Indexed like validator_.keys()
+    String unresolved_;           // First bound key missing from the schema
+
+    BoundValidator &add(const char *key, const Setter &setter)
+    {
+        const Validator::KeyEntry *entry = validator_.findKey(key, strlen(key));
+        if (entry == nullptr || setters_.size() != validator_.keys().size())
+        {
+            if (unresolved_.isEmpty())
+                unresolved_ = key;
+            return *this;
+        }
+        setters_[entry - validator_.keys().data()] = setter;
+        return *this;
+    }
+};
+
+#endif // PAT_boundValidator_H
@@ -5,6 +5,9 @@
 #include <regex>
 #include <iostream>
 #include "PAT_regexConfig.h"
+#include "PAT_regexEngine.h"
+#include "PAT_utf8.h"
+#include "PAT_fieldCipher.h"
 //===========================================================================================================================================
 #ifndef IF_LOG_VALIDATOR_IS_ON
 // #define IF_LOG_VALIDATOR_IS_ON(xxx) xxx
@@ -22,278 +25,917 @@
 #include <ArduinoJson.h>
 #include <regex>
 #include <cstring>
+#include <cmath>
 #include <vector>
 #include <string>
 #include <iostream>
 #include <map>
+#include <algorithm>
 #include <functional>
 #include "PAT_OS.h"
 #include "esp_heap_caps.h" // For heap_caps_malloc()
+#include <memory>
 
 #define regex_phone "^\\+?[1-9][0-9]{1,14}$"
-class FieldSchema : public Class_Log
+
+#ifndef VALIDATOR_NORMALIZE_SCRATCH
+#define VALIDATOR_NORMALIZE_SCRATCH 128 // Stack bytes for one trimmed/case-folded string, NUL included
+#endif
+#ifndef VALIDATOR_CIPHER_SCRATCH
+#define VALIDATOR_CIPHER_SCRATCH 128 // Stack bytes for the plaintext of one encrypted field (multiple of 16)
+#endif
+//-------------------------------------------------------------------
+// Per-call validation state
+//
+// Everything a validation pass writes lives here, not in the schema: the logger of the Validator doing
+// the walk, the key being checked, the first failure and counters. A context belongs to one call on one
+// task; the compiled FieldSchema/Validator stay read-only and can be shared between tasks.
+//-------------------------------------------------------------------
+enum class ValidationError : uint8_t
 {
-private:
-    String fieldType = ""; // Field type: "string", "integer", "float", "boolean", "array", "object"
-    bool isRequiredField = false;
+    None = 0,
+    MissingRequired,
+    WrongType,
+    ValueOutOfRange,
+    LengthOutOfRange,
+    ItemsOutOfRange,
+    PatternMismatch,
+    PatternInvalid,
+    PatternBudgetExceeded, // Regex gave up after its step budget; the value is rejected
+    CrossFieldViolation,   // A rule between keys (addRelation, addRequiredIf, ...) does not hold
+    UnknownKey,            // Strict validator: key not in the schema, or present twice
+    TooManyKeys,           // Object has more members than setMaxKeys() allows
+    NoCapacity,            // A default or normalised value could not be stored (JsonDocument full, or longer than VALIDATOR_NORMALIZE_SCRATCH)
+    InvalidEncoding,       // String is not well-formed UTF-8 (setUtf8 / setLengthInCodePoints)
+    DecryptFailed,         // Encrypted field does not decrypt (within VALIDATOR_CIPHER_SCRATCH) or its plaintext breaks the rules
+};
+
+struct ValidationContext;
 
-    float minValue = 0.0f; // Minimum value for numbers
-    float maxValue = 0.0f; // Maximum value for numbers
+// Receives each value that passed its schemas, and the default of each missing key that has one, during
+// the walk (see PAT_boundValidator.h). `keyIndex` is the position of the key in Validator::keys().
+// Returning false fails the validation.
+class ValueSink
+{
+public:
+    virtual bool accept(size_t keyIndex, const JsonVariant &value, ValidationContext &ctx) const = 0;
 
-    int minLength = 0; // Minimum length for strings
-    int maxLength = 0; // Maximum length for strings
+protected:
+    ~ValueSink() = default;
+};
 
-    int minItems = 0; // Minimum number of items in arrays
-    int maxItems = 0; // Maximum number of items in arrays
+struct ValidationContext
+{
+    const Class_Log *logger = nullptr;     // Validator whose log settings apply, nullptr when logging is off
+    const ValueSink *sink = nullptr;       // Optional per-call consumer of validated values
+    const char *field = "";                // Key currently being validated
+    const char *failedField = nullptr;     // First key that failed, points into the schema (into the document for UnknownKey/TooManyKeys)
+    ValidationError error = ValidationError::None;
+    uint16_t fieldsChecked = 0;            // Schema entries evaluated in this call
+
+    bool fail(ValidationError reason)
+    {
+        if (error == ValidationError::None)
+        {
+            error = reason;
+            failedField = field;
+        }
+        return false;
+    }
+
+    void reset()
+    {
+        field = "";
+        failedField = nullptr;
+        error = ValidationError::None;
+        fieldsChecked = 0;
+    }
+};
+
+#define LOG_VALIDATION_CONTEXT(ctx, ...) \
+    if ((ctx).logger)                    \
+    (ctx).logger->log(__VA_ARGS__)
+//-------------------------------------------------------------------
+// Compiled field rules
+//
+// Plain data with a fixed layout: FieldSchema keeps one, and schema plans (PAT_schemaPlan.h) store them
+// verbatim so a plan in flash can be validated against without rebuilding FieldSchemas.
+//-------------------------------------------------------------------
+enum class FieldType : uint8_t
+{
+    Unknown = 0,
+    Boolean,
+    Integer,
+    Float,
+    String,
+    Array,
+};
+
+enum class FieldCase : uint8_t
+{
+    Keep = 0,
+    Lower,
+    Upper,
+};
+
+struct FieldRules
+{
+    enum Flags : uint8_t
+    {
+        Required = 1 << 0,
+        ValueConstraints = 1 << 1,
+        LengthConstraints = 1 << 2,
+        ItemsConstraints = 1 << 3,
+        Pattern = 1 << 4,
+        Utf8 = 1 << 5,       // Reject strings that are not well-formed UTF-8
+        CodePoints = 1 << 6, // minLength/maxLength count code points instead of bytes
+    };
+
+    // Normalisation applied to the value in place, before the checks
+    enum Transforms : uint16_t
+    {
+        Trim = 1 << 0,      // Strip leading/trailing ASCII whitespace
+        Lowercase = 1 << 1, // ASCII case folding
+        Uppercase = 1 << 2,
+        Clamp = 1 << 3, // Out-of-range numbers are set to the nearest bound instead of rejected
+    };
+
+    FieldType type;
+    uint8_t flags;
+    uint16_t transforms;
+
+    float minValue; // Minimum value for numbers
+    float maxValue; // Maximum value for numbers
+
+    int32_t minLength; // Minimum length for strings, in bytes or code points
+    int32_t maxLength; // Maximum length for strings, in bytes or code points
+
+    int32_t minItems; // Minimum number of items in arrays
+    int32_t maxItems; // Maximum number of items in arrays
+
+    uint32_t patternBudget; // Regex step budget for non-linear patterns, 0 = PAT_REGEX_STEP_BUDGET
+
+    bool has(Flags flag) const { return (flags & flag) != 0; }
+    bool has(Transforms transform) const { return (transforms & transform) != 0; }
+};
+
+// Patterns a string must all match: a FieldSchema's own, or every pattern of a merged key
+struct PatternSet
+{
+    const PatRegexView *programs;
+    const uint32_t *budgets; // Step budget per program
+    size_t count;
+};
+//-------------------------------------------------------------------
+class FieldSchema
+{
+private:
+    FieldRules rules = {FieldType::Unknown, 0, 0, 0.0f, 0.0f, 0, 0, 0, 0, 0};
 
     String regexPattern = ""; // Regex pattern for string validation
+    std::shared_ptr<const PatRegex> compiledPattern; // Compiled once in setPattern(), shared between copies
+    PatRegexView patternView = {};                   // Program of compiledPattern, valid while it is alive
+    bool patternError = false;                       // setPattern() received a pattern PatRegex rejected
+    std::shared_ptr<DynamicJsonDocument> defaultValue; // setDefault(), shared between copies and never written after
+    const FieldCipher *cipher = nullptr;               // setEncrypted(), not owned
     String fieldDescription = "";
 
-    bool hasValueConstraints = false;
-    bool hasLengthConstraints = false;
-    bool hasItemsConstraints = false;
-
 public:
     bool validate(const JsonVariant &value) const
     {
+        ValidationContext ctx;
+        return validate(value, ctx);
+    }
 
-        if (fieldType == "boolean")
-            return value.is<bool>();
-        if (fieldType == "integer")
-            return validateInteger(value);
-        if (fieldType == "float")
-            return validateFloat(value);
-        if (fieldType == "string")
-            return validateString(value);
-        if (fieldType == "array")
-            return validateArray(value);
+    bool validate(const JsonVariant &value, ValidationContext &ctx) const
+    {
+        if (patternError)
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_RED, TEXT_BOLD, "[%s] regex pattern failed to compile.\n", ctx.field);)
+            return ctx.fail(ValidationError::PatternInvalid);
+        }
+        if (cipher && rules.type == FieldType::String)
+            return validateEncrypted(value, ctx);
+        return validateRules(rules, getPatternProgram(), value, ctx);
+    }
 
-        IF_LOG_VALIDATOR_IS_ON(log(COLOR_RED, TEXT_NORMAL, "is nit valid\n");)
-        return false;
+    //----------------------------------------------
+    // Core checks, shared by FieldSchema and schema plans. `pattern` must be non-null when the rules
+    // carry FieldRules::Pattern.
+    static bool validateRules(const FieldRules &rules, const PatRegexView *pattern, const JsonVariant &value, ValidationContext &ctx)
+    {
+        uint32_t budget = stepBudget(rules);
+        PatternSet patterns = {pattern, &budget, rules.has(FieldRules::Pattern) ? 1u : 0u};
+        return validateRules(rules, patterns, value, ctx);
+    }
+
+    static bool validateRules(const FieldRules &rules, const PatternSet &patterns, const JsonVariant &value, ValidationContext &ctx)
+    {
+        ++ctx.fieldsChecked;
+        switch (rules.type)
+        {
+        case FieldType::Boolean:
+            return value.is<bool>() || ctx.fail(ValidationError::WrongType);
+        case FieldType::Integer:
+            return validateInteger(rules, value, ctx);
+        case FieldType::Float:
+            return validateFloat(rules, value, ctx);
+        case FieldType::String:
+            return validateString(rules, patterns, value, ctx);
+        case FieldType::Array:
+            return validateArray(rules, value, ctx);
+        default:
+            break;
+        }
+
+        IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_RED, TEXT_NORMAL, "[%s] is not valid\n", ctx.field);)
+        return ctx.fail(ValidationError::WrongType);
     }
 
     bool isRequired() const
     {
-        return isRequiredField;
+        return rules.has(FieldRules::Required);
     }
 
     FieldSchema &setType(const String &type)
     {
-        fieldType = type;
+        // Field type: "string", "integer", "float", "boolean", "array"
+        if (type == "boolean")
+            rules.type = FieldType::Boolean;
+        else if (type == "integer")
+            rules.type = FieldType::Integer;
+        else if (type == "float")
+            rules.type = FieldType::Float;
+        else if (type == "string")
+            rules.type = FieldType::String;
+        else if (type == "array")
+            rules.type = FieldType::Array;
+        else
+            rules.type = FieldType::Unknown;
         return *this;
     }
 
     FieldSchema &setRequired(bool required)
     {
-        isRequiredField = required;
+        if (required)
+            rules.flags |= FieldRules::Required;
+        else
+            rules.flags &= ~FieldRules::Required;
         return *this;
     }
 
     FieldSchema &setMinValue(float minVal)
     {
-        minValue = minVal;
-        hasValueConstraints = true;
+        rules.minValue = minVal;
+        rules.flags |= FieldRules::ValueConstraints;
         return *this;
     }
 
     FieldSchema &setMaxValue(float maxVal)
     {
-        maxValue = maxVal;
-        hasValueConstraints = true;
+        rules.maxValue = maxVal;
+        rules.flags |= FieldRules::ValueConstraints;
         return *this;
     }
 
     FieldSchema &setValue(float minVal, float maxVal)
     {
-        minValue = minVal;
-        maxValue = maxVal;
-        hasValueConstraints = true;
+        rules.minValue = minVal;
+        rules.maxValue = maxVal;
+        rules.flags |= FieldRules::ValueConstraints;
         return *this;
     }
 
     FieldSchema &setMinLength(int minLen)
     {
-        minLength = minLen;
-        hasLengthConstraints = true;
+        rules.minLength = minLen;
+        rules.flags |= FieldRules::LengthConstraints;
         return *this;
     }
 
     FieldSchema &setMaxLength(int maxLen)
     {
-        maxLength = maxLen;
-        hasLengthConstraints = true;
+        rules.maxLength = maxLen;
+        rules.flags |= FieldRules::LengthConstraints;
         return *this;
     }
 
     FieldSchema &setLength(int minLen, int maxLen)
     {
-        minLength = minLen;
-        maxLength = maxLen;
-        hasLengthConstraints = true;
+        rules.minLength = minLen;
+        rules.maxLength = maxLen;
+        rules.flags |= FieldRules::LengthConstraints;
         return *this;
     }
 
     FieldSchema &setMinItems(int minItm)
     {
-        minItems = minItm;
-        hasItemsConstraints = true;
+        rules.minItems = minItm;
+        rules.flags |= FieldRules::ItemsConstraints;
         return *this;
     }
 
     FieldSchema &setMaxItems(int maxItm)
     {
-        maxItems = maxItm;
-        hasItemsConstraints = true;
+        rules.maxItems = maxItm;
+        rules.flags |= FieldRules::ItemsConstraints;
         return *this;
     }
 
     FieldSchema &setItems(int minItm, int maxItm)
     {
-        minItems = minItm;
-        maxItems = maxItm;
-        hasItemsConstraints = true;
+        rules.minItems = minItm;
+        rules.maxItems = maxItm;
+        rules.flags |= FieldRules::ItemsConstraints;
         return *this;
     }
 
     FieldSchema &setPattern(const String &pattern)
     {
         regexPattern = pattern;
+        compiledPattern.reset();
+        patternError = false;
+        rules.flags &= ~FieldRules::Pattern;
+        if (pattern.isEmpty())
+            return *this;
+        rules.flags |= FieldRules::Pattern;
+        std::shared_ptr<PatRegex> regex = std::make_shared<PatRegex>();
+        if (!regex->compile(pattern.c_str()))
+        {
+            // Fail closed: a schema with a broken pattern never accepts a value
+            patternError = true;
+            return *this;
+        }
+        patternView = regex->view();
+        compiledPattern = regex;
         return *this;
     }
 
-private:
-    bool validateString(const JsonVariant &value) const
+    // Reject strings that are not well-formed UTF-8 (overlong forms, surrogates, truncated sequences)
+    FieldSchema &setUtf8(bool wellFormed)
     {
+        if (wellFormed)
+            rules.flags |= FieldRules::Utf8;
+        else
+            rules.flags &= ~(FieldRules::Utf8 | FieldRules::CodePoints);
+        return *this;
+    }
 
-        if (!value.is<String>())
+    // Count setLength/setMinLength/setMaxLength in code points, so "سلام" is 4 long rather than 8.
+    // Implies setUtf8(true).
+    FieldSchema &setLengthInCodePoints(bool codePoints)
+    {
+        if (codePoints)
+            rules.flags |= FieldRules::Utf8 | FieldRules::CodePoints;
+        else
+            rules.flags &= ~FieldRules::CodePoints;
+        return *this;
+    }
+
+    // Step budget for patterns that need backtracking (backreferences, lookaheads); linear patterns
+    // ignore it. 0 restores the PAT_REGEX_STEP_BUDGET default.
+    FieldSchema &setPatternBudget(uint32_t steps)
+    {
+        rules.patternBudget = steps;
+        return *this;
+    }
+
+    //----------------------------------------------
+    // Normalisation, applied to the document in place as the field is validated, so later checks, the
+    // bound struct and the handler all see the normalised value. Trim and case folding build the
+    // normalised value in a VALIDATOR_NORMALIZE_SCRATCH-byte stack buffer and copy it into the document's
+    // pool (the original bytes are never written, since ArduinoJson shares equal strings). A longer value
+    // or a full pool fails with NoCapacity.
+    FieldSchema &setTrim(bool trim)
+    {
+        if (trim)
+            rules.transforms |= FieldRules::Trim;
+        else
+            rules.transforms &= ~FieldRules::Trim;
+        return *this;
+    }
+
+    FieldSchema &setCase(FieldCase fold)
+    {
+        rules.transforms &= ~(FieldRules::Lowercase | FieldRules::Uppercase);
+        if (fold == FieldCase::Lower)
+            rules.transforms |= FieldRules::Lowercase;
+        else if (fold == FieldCase::Upper)
+            rules.transforms |= FieldRules::Uppercase;
+        return *this;
+    }
+
+    // With value constraints, numbers outside [min, max] are replaced by the nearest bound
+    FieldSchema &setClamp(bool clamp)
+    {
+        if (clamp)
+            rules.transforms |= FieldRules::Clamp;
+        else
+            rules.transforms &= ~FieldRules::Clamp;
+        return *this;
+    }
+
+    // Value used when the key is missing from an object: written into the document, or handed to the
+    // bound struct when validating through a BoundValidator. The default is not checked against the rules.
+    FieldSchema &setDefault(bool value) { return storeDefault(value); }
+    FieldSchema &setDefault(int value) { return storeDefault(value); }
+    FieldSchema &setDefault(double value) { return storeDefault(value); }
+    FieldSchema &setDefault(const char *value) { return storeDefault(String(value)); } // copied
+    FieldSchema &setDefault(const String &value) { return storeDefault(value); }
+
+    bool hasDefault() const
+    {
+        return defaultValue != nullptr;
+    }
+
+    JsonVariant getDefault() const
+    {
+        return defaultValue ? defaultValue->as<JsonVariant>() : JsonVariant();
+    }
+
+    //----------------------------------------------
+    // String field that carries ciphertext (e.g. the hex produced by AESLibrary::encrypt). Length, UTF-8 and
+    // pattern rules apply to the plaintext, which is decrypted into a VALIDATOR_CIPHER_SCRATCH-byte buffer
+    // on the stack of the validating call and wiped before it returns; the document keeps the ciphertext
+    // and normalisation is not applied. The cipher must outlive the schema. nullptr turns it off.
+    FieldSchema &setEncrypted(const FieldCipher *fieldCipher)
+    {
+        cipher = fieldCipher;
+        return *this;
+    }
+
+    const FieldCipher *getCipher() const
+    {
+        return cipher;
+    }
+
+    FieldSchema &setDescription(const String &description)
+    {
+        fieldDescription = description;
+        return *this;
+    }
+
+    bool hasPatternError() const
+    {
+        return patternError;
+    }
+
+    const FieldRules &getRules() const
+    {
+        return rules;
+    }
+
+    const String &getPattern() const
+    {
+        return regexPattern;
+    }
+
+    const PatRegex *getCompiledPattern() const
+    {
+        return compiledPattern.get();
+    }
+
+    // Program to pass to checkPattern(), nullptr when there is no usable pattern
+    const PatRegexView *getPatternProgram() const
+    {
+        return compiledPattern ? &patternView : nullptr;
+    }
+
+    const String &getDescription() const
+    {
+        return fieldDescription;
+    }
+
+    //----------------------------------------------
+    // Raw-value checks, for encodings that are validated without a JsonVariant (MessagePack, CBOR).
+    // The caller has already matched the wire type against rules.type.
+    static bool checkLength(const FieldRules &rules, size_t length, ValidationContext &ctx)
+    {
+        if (rules.has(FieldRules::LengthConstraints) && ((int64_t)length < rules.minLength || (int64_t)length > rules.maxLength))
         {
-            IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "not a string.\n");)
-            return false;
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] string length out of bounds. Length: %u, Min: %d, Max: %d\n", ctx.field, (unsigned)length, rules.minLength, rules.maxLength);)
+            return ctx.fail(ValidationError::LengthOutOfRange);
         }
+        return true;
+    }
 
-        if (hasLengthConstraints)
-        {
-            String str = value.as<String>();
-            int length = str.length();
+    // Encoding, length and pattern of a string of `length` bytes
+    static bool checkString(const FieldRules &rules, const PatRegexView *pattern, const char *str, size_t length, ValidationContext &ctx)
+    {
+        uint32_t budget = stepBudget(rules);
+        PatternSet patterns = {pattern, &budget, rules.has(FieldRules::Pattern) ? 1u : 0u};
+        return checkString(rules, patterns, str, length, ctx);
+    }
 
-            if (length < minLength || length > maxLength)
-            {
-                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "string length out of bounds. Length: %d, Min: %d, Max: %d\n", length, minLength, maxLength);)
-                return false;
-            }
+    static bool checkString(const FieldRules &rules, const PatternSet &patterns, const char *str, size_t length, ValidationContext &ctx)
+    {
+        size_t measured = length;
+        if (rules.has(FieldRules::Utf8) && !PatUtf8::validate(str, length, rules.has(FieldRules::CodePoints) ? &measured : nullptr))
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] string is not valid UTF-8.\n", ctx.field);)
+            return ctx.fail(ValidationError::InvalidEncoding);
         }
+        return checkLength(rules, measured, ctx) && checkPatterns(patterns, str, str + length, ctx);
+    }
 
-        if (!regexPattern.isEmpty())
+    // Decrypts `length` bytes of ciphertext into scratch, checks the plaintext with checkString() and wipes it.
+    // Every failure is reported as DecryptFailed: telling bad padding apart from a plaintext that breaks
+    // the rules would give clients a CBC padding oracle.
+    static bool checkEncrypted(const FieldRules &rules, const PatternSet &patterns, const FieldCipher &fieldCipher, const char *str, size_t length, ValidationContext &ctx)
+    {
+        uint8_t plaintext[VALIDATOR_CIPHER_SCRATCH];
+        int plainLength = fieldCipher.decrypt(str, length, plaintext, sizeof(plaintext));
+        ValidationError before = ctx.error;
+        bool valid = false;
+        if (plainLength < 0)
         {
-            String str = value.as<String>();
-            if (!std::regex_search(str.c_str(), std::regex(regexPattern.c_str())))
-            {
-                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "string does not match regex pattern.\n");)
-                return false;
-            }
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] encrypted value could not be decrypted.\n", ctx.field);)
         }
+        else
+            valid = checkString(rules, patterns, (const char *)plaintext, plainLength, ctx);
+        FieldCipher::wipe(plaintext, sizeof(plaintext));
+        if (!valid && before == ValidationError::None)
+        {
+            ctx.error = ValidationError::None; // replace the plaintext rule that failed
+            ctx.fail(ValidationError::DecryptFailed);
+        }
+        return valid;
+    }
 
-        // log(COLOR_GREEN, TEXT_NORMAL, "String validation succeeded.\n");
+    static bool checkPattern(const FieldRules &rules, const PatRegexView *pattern, const char *begin, const char *end, ValidationContext &ctx)
+    {
+        uint32_t budget = stepBudget(rules);
+        PatternSet patterns = {pattern, &budget, rules.has(FieldRules::Pattern) ? 1u : 0u};
+        return checkPatterns(patterns, begin, end, ctx);
+    }
+
+    // Several patterns are matched in one pass over the string (PatRegex::searchAll)
+    static bool checkPatterns(const PatternSet &patterns, const char *begin, const char *end, ValidationContext &ctx)
+    {
+        if (patterns.count == 0)
+            return true;
+        PatRegexResult result = patterns.count == 1 ? PatRegex::search(patterns.programs[0], begin, end, patterns.budgets[0])
+                                                    : PatRegex::searchAll(patterns.programs, patterns.budgets, patterns.count, begin, end);
+        if (result == PatRegexResult::BudgetExhausted)
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_RED, TEXT_BOLD, "[%s] regex step budget exhausted, value rejected.\n", ctx.field);)
+            return ctx.fail(ValidationError::PatternBudgetExceeded);
+        }
+        if (result != PatRegexResult::Match)
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] string does not match regex pattern.\n", ctx.field);)
+            return ctx.fail(ValidationError::PatternMismatch);
+        }
         return true;
     }
 
-    bool validateInteger(const JsonVariant &value) const
+    static uint32_t stepBudget(const FieldRules &rules)
     {
-        if (!value.is<int>())
+        return rules.patternBudget ? rules.patternBudget : PAT_REGEX_STEP_BUDGET;
+    }
+
+    static bool checkInteger(const FieldRules &rules, int val, ValidationContext &ctx)
+    {
+        if (rules.has(FieldRules::ValueConstraints) && (val < rules.minValue || val > rules.maxValue))
         {
-            IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "not an integer.\n");)
-            return false;
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] integer value out of bounds. Value: %d, Min: %f, Max: %f\n", ctx.field, val, rules.minValue, rules.maxValue);)
+            return ctx.fail(ValidationError::ValueOutOfRange);
         }
+        return true;
+    }
 
-        if (hasValueConstraints)
+    static bool checkFloat(const FieldRules &rules, float val, ValidationContext &ctx)
+    {
+        if (rules.has(FieldRules::ValueConstraints) && (val < rules.minValue || val > rules.maxValue))
         {
-            int val = value.as<int>();
-            if (val < minValue || val > maxValue)
-            {
-                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "integer value out of bounds. Value: %d, Min: %f, Max: %f\n", val, minValue, maxValue);)
-                return false;
-            }
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] float value out of bounds. Value: %f, Min: %f, Max: %f\n", ctx.field, val, rules.minValue, rules.maxValue);)
+            return ctx.fail(ValidationError::ValueOutOfRange);
         }
+        return true;
+    }
 
-        // log(COLOR_GREEN, TEXT_NORMAL, "Integer validation succeeded.\n");
+    static bool checkItems(const FieldRules &rules, size_t size, ValidationContext &ctx)
+    {
+        if (rules.has(FieldRules::ItemsConstraints) && ((int64_t)size < rules.minItems || (int64_t)size > rules.maxItems))
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] array size out of bounds. Size: %u, Min: %d, Max: %d\n", ctx.field, (unsigned)size, rules.minItems, rules.maxItems);)
+            return ctx.fail(ValidationError::ItemsOutOfRange);
+        }
         return true;
     }
 
-    bool validateFloat(const JsonVariant &value) const
+private:
+    template <typename V>
+    FieldSchema &storeDefault(const V &value)
     {
-        if (!value.is<float>())
+        std::shared_ptr<DynamicJsonDocument> doc = std::make_shared<DynamicJsonDocument>(JSON_STRING_SIZE(defaultLength(value)) + 8);
+        doc->as<JsonVariant>().set(value);
+        defaultValue = doc;
+        return *this;
+    }
+
+    static size_t defaultLength(const String &value) { return value.length(); }
+    template <typename V>
+    static size_t defaultLength(const V &) { return 0; }
+
+    // Trim bounds of `str` in [begin, end); true when trimming or case folding changes the value
+    static bool needsNormalizing(const FieldRules &rules, const char *str, size_t length, size_t &begin, size_t &end)
+    {
+        begin = 0, end = length;
+        if (rules.has(FieldRules::Trim))
         {
-            IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "not a float.\n");)
-            return false;
+            while (begin < end && isspace((unsigned char)str[begin]))
+                ++begin;
+            while (end > begin && isspace((unsigned char)str[end - 1]))
+                --end;
+        }
+        if (begin != 0 || end != length)
+            return true;
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (foldedChar(rules, str[i]) != str[i])
+                return true;
+        }
+        return false;
+    }
+
+    static char foldedChar(const FieldRules &rules, char c)
+    {
+        if (rules.has(FieldRules::Lowercase) ? (c >= 'A' && c <= 'Z') : rules.has(FieldRules::Uppercase) && (c >= 'a' && c <= 'z'))
+            return c ^ 0x20;
+        return c;
+    }
+
+    bool validateEncrypted(const JsonVariant &value, ValidationContext &ctx) const
+    {
+        ++ctx.fieldsChecked;
+        if (!value.is<String>())
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] not a string.\n", ctx.field);)
+            return ctx.fail(ValidationError::WrongType);
+        }
+        uint32_t budget = stepBudget(rules);
+        PatternSet patterns = {getPatternProgram(), &budget, rules.has(FieldRules::Pattern) ? 1u : 0u};
+        const char *str = value.as<const char *>();
+        return checkEncrypted(rules, patterns, *cipher, str, strlen(str), ctx);
+    }
+
+    static bool validateString(const FieldRules &rules, const PatternSet &patterns, const JsonVariant &value, ValidationContext &ctx)
+    {
+        if (!value.is<String>())
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] not a string.\n", ctx.field);)
+            return ctx.fail(ValidationError::WrongType);
         }
 
-        if (hasValueConstraints)
+        const char *str = value.as<const char *>();
+        size_t length = strlen(str);
+        size_t begin, end;
+        if ((rules.transforms & (FieldRules::Trim | FieldRules::Lowercase | FieldRules::Uppercase)) && needsNormalizing(rules, str, length, begin, end))
         {
-            float val = value.as<float>();
-            if (val < minValue || val > maxValue)
+            length = end - begin;
+            if (length >= VALIDATOR_NORMALIZE_SCRATCH)
             {
-                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "float value out of bounds. Value: %f, Min: %f, Max: %f\n", val, minValue, maxValue);)
-                return false;
+                if (rules.has(FieldRules::LengthConstraints) && !rules.has(FieldRules::CodePoints) && (int64_t)length > rules.maxLength)
+                    return checkLength(rules, length, ctx); // too long either way
+                IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_RED, TEXT_BOLD, "[%s] value too long to normalise.\n", ctx.field);)
+                return ctx.fail(ValidationError::NoCapacity);
+            }
+            // A copy, never the stored bytes: ArduinoJson shares equal strings between values and keys,
+            // and linked `const char*` values belong to the application
+            char normalized[VALIDATOR_NORMALIZE_SCRATCH];
+            for (size_t i = 0; i < length; ++i)
+                normalized[i] = foldedChar(rules, str[begin + i]);
+            normalized[length] = '\0';
+            JsonVariant target = value;
+            if (!target.set(static_cast<char *>(normalized))) // char*: copied into the pool
+            {
+                IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_RED, TEXT_BOLD, "[%s] no room for the normalised value.\n", ctx.field);)
+                return ctx.fail(ValidationError::NoCapacity);
             }
+            str = value.as<const char *>();
         }
+        return checkString(rules, patterns, str, length, ctx);
+    }
 
-        // log(COLOR_GREEN, TEXT_NORMAL, "Float validation succeeded.\n");
-        return true;
+    static bool validateInteger(const FieldRules &rules, const JsonVariant &value, ValidationContext &ctx)
+    {
+        if (!value.is<int>())
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] not an integer.\n", ctx.field);)
+            return ctx.fail(ValidationError::WrongType);
+        }
+        int val = value.as<int>();
+        if (rules.has(FieldRules::Clamp) && rules.has(FieldRules::ValueConstraints) && (val < rules.minValue || val > rules.maxValue))
+        {
+            // An empty integer range (e.g. [0.2, 0.8]) still fails the check below
+            val = val < rules.minValue ? (int)ceilf(rules.minValue) : (int)floorf(rules.maxValue);
+            JsonVariant target = value;
+            target.set(val);
+        }
+        return checkInteger(rules, val, ctx);
+    }
+
+    static bool validateFloat(const FieldRules &rules, const JsonVariant &value, ValidationContext &ctx)
+    {
+        if (!value.is<float>())
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] not a float.\n", ctx.field);)
+            return ctx.fail(ValidationError::WrongType);
+        }
+        float val = value.as<float>();
+        if (rules.has(FieldRules::Clamp) && rules.has(FieldRules::ValueConstraints) && (val < rules.minValue || val > rules.maxValue))
+        {
+            val = val < rules.minValue ? rules.minValue : rules.maxValue;
+            JsonVariant target = value;
+            target.set(val);
+        }
+        return checkFloat(rules, val, ctx);
     }
 
-    bool validateArray(const JsonVariant &value) const
+    static bool validateArray(const FieldRules &rules, const JsonVariant &value, ValidationContext &ctx)
     {
         if (!value.is<JsonArray>())
         {
-            IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "not an array.\n");)
-            return false;
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] not an array.\n", ctx.field);)
+            return ctx.fail(ValidationError::WrongType);
+        }
+        return checkItems(rules, value.as<JsonArray>().size(), ctx);
+    }
+};
+//-------------------------------------------------------------------
+// Cross-field rules
+//
+// Relations between keys of one object, declared on the Validator and checked at the end of the same
+// walk that validated the fields. Each key a rule refers to is captured by reference as the walk passes
+// it, so the document is not queried a second time. Keys named in a rule must also have a FieldSchema;
+// a rule naming a key the schema does not know fails closed.
+//-------------------------------------------------------------------
+#ifndef VALIDATOR_MAX_KEYS
+#define VALIDATOR_MAX_KEYS 128 // Schema keys tracked per object by the member walk (stack bitmap)
+#endif
+#ifndef VALIDATOR_MAX_CROSS_KEYS
+#define VALIDATOR_MAX_CROSS_KEYS 16 // Distinct keys referenced by cross-field rules, per Validator
+#endif
+
+enum class FieldRelation : uint8_t
+{
+    Equal,
+    NotEqual,
+    Less,
+    LessOrEqual,
+    Greater,
+    GreaterOrEqual,
+};
+
+// A value seen during the walk; strings point into the document being validated
+struct CapturedValue
+{
+    enum Kind : uint8_t
+    {
+        Absent = 0,
+        Null,
+        Bool,
+        Number,
+        String,
+        Other, // object or array, only usable for presence
+    };
+
+    Kind kind;
+    double number;   // Bool and Number
+    const char *str; // String, not necessarily NUL-terminated
+    size_t length;
+
+    static CapturedValue from(const JsonVariant &value)
+    {
+        CapturedValue c = {Other, 0.0, nullptr, 0};
+        if (value.isNull())
+            c.kind = Null;
+        else if (value.is<bool>())
+        {
+            c.kind = Bool;
+            c.number = value.as<bool>() ? 1.0 : 0.0;
         }
-        if (hasItemsConstraints)
+        else if (value.is<double>())
         {
-            JsonArray array = value.as<JsonArray>();
-            int size = array.size();
-            if (size < minItems || size > maxItems)
-            {
-                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "array size out of bounds. Size: %d, Min: %d, Max: %d\n", size, minItems, maxItems);)
-                return false;
-            }
+            c.kind = Number;
+            c.number = value.as<double>();
         }
-        return true;
+        else if (value.is<const char *>())
+        {
+            c.kind = String;
+            c.str = value.as<const char *>();
+            c.length = strlen(c.str);
+        }
+        return c;
+    }
+};
+
+struct CrossFieldRule
+{
+    enum Kind : uint8_t
+    {
+        Relation,          // slots: left, right
+        RequiredIf,        // slots: field, trigger
+        MutuallyExclusive, // slots: every key of the group
+    };
+
+    Kind kind;
+    FieldRelation relation;
+    std::vector<uint8_t> slots; // Indexes into the validator's captured keys
+};
+//-------------------------------------------------------------------
+// Several FieldSchemas on one key (addField called more than once for a name), folded into one set of
+// rules when the validator is built: the type is checked once, value/length/items ranges are intersected
+// and all patterns are matched in a single pass over the string (PatRegex::searchAll).
+//-------------------------------------------------------------------
+struct MergedField
+{
+    FieldRules rules;
+    std::vector<PatRegexView> programs; // Point into the compiled patterns of the key's FieldSchemas
+    std::vector<uint32_t> budgets;
+
+    PatternSet patterns() const
+    {
+        PatternSet set = {programs.data(), budgets.data(), programs.size()};
+        return set;
     }
 };
 //-------------------------------------------------------------------
 // JSON Validator Class
 //-------------------------------------------------------------------
+//
+// Thread safety: a Validator is built once (addField, logOn/logOff) and is read-only afterwards. Every
+// const member may then be called concurrently from any number of FreeRTOS tasks or host threads on the
+// same instance; all per-call state lives in the ValidationContext of the caller. Building or changing a
+// Validator that other tasks are already using is not supported - publish a new one (see ValidatorSlot).
+//-------------------------------------------------------------------
 class Validator : public Class_Log
 {
+public:
+    //----------------------------------------------
+    // Compiled key lookup: one entry per name, sorted by hash. Entries point into fields_, whose nodes
+    // never move, and are rebuilt whenever a field is added or the validator is copied.
+    struct KeyEntry
+    {
+        uint32_t hash;
+        uint16_t length;
+        bool required;
+        bool defaulted; // Some schema supplies a value when the key is missing
+        int8_t capture; // Cross-field capture slot, -1 if no rule reads this key
+        uint16_t field; // Position of the key in fields() order
+        int16_t merged; // Index of the key's MergedField, -1 when its schemas run one by one
+        const char *name;
+        const std::vector<FieldSchema> *schemas;
+    };
+
+private:
     std::map<String, std::vector<FieldSchema>> fields_; // A map to store fields with their associated names
+    std::vector<KeyEntry> keys_;
+    std::vector<String> crossNames_;        // Keys captured for cross-field rules, by slot
+    std::vector<CrossFieldRule> crossRules_;
+    std::vector<int8_t> fieldCaptures_;     // Capture slot per fields_ entry, in map order
+    std::vector<uint16_t> fieldKeys_;       // keys_ index per fields_ entry, in map order
+    std::vector<MergedField> merged_;       // Folded rules of keys with several schemas
+    const char *crossUnresolved_ = nullptr; // First rule key without a FieldSchema, or too many keys
+    bool strict_ = false;                   // Reject object members the schema does not know
+    uint16_t maxKeys_ = 0;                  // Maximum object members, 0 = unlimited
+    bool logEnabled_ = false;
     //----------------------------------------------
 public:
     Validator() = default;
+    Validator(const Validator &other) : Class_Log(other), fields_(other.fields_), crossNames_(other.crossNames_), crossRules_(other.crossRules_), strict_(other.strict_), maxKeys_(other.maxKeys_), logEnabled_(other.logEnabled_)
+    {
+        rebuildKeys();
+    }
+    Validator &operator=(const Validator &other)
+    {
+        if (this != &other)
+        {
+            Class_Log::operator=(other);
+            fields_ = other.fields_;
+            crossNames_ = other.crossNames_;
+            crossRules_ = other.crossRules_;
+            strict_ = other.strict_;
+            maxKeys_ = other.maxKeys_;
+            logEnabled_ = other.logEnabled_;
+            rebuildKeys();
+        }
+        return *this;
+    }
     //----------------------------------------------
+    // Field-level messages are routed through this validator's logger via ValidationContext, so enabling
+    // logging no longer touches the (shared, immutable) FieldSchemas.
     void logOn(String name = "") override
     {
+        (void)name; // Unused when logging is compiled out
         IF_LOG_VALIDATOR_IS_ON(
             if (name.isEmpty()) {
                 Class_Log::init(COLOR_MAGENTA, TEXT_BOLD, "[%s]:", "Validator");
             } else {
                 Class_Log::init(COLOR_MAGENTA, TEXT_BOLD, "[%s]:", name.c_str());
             } Class_Log::setLogOn();
-            for (auto it = fields_.begin(); it != fields_.end(); ++it) {
-                String fullName = name + "][" + String(it->first);
-                for (const FieldSchema &fieldSchema : it->second)
-                {
-                    if (&fieldSchema != nullptr)
-                    {
-                        // Assuming FieldSchema has a non-const logOn method
-                        const_cast<FieldSchema &>(fieldSchema).logOn(fullName.c_str());
-                    }
-                    else
-                    {
-                        log(ERROR, "A null pointer reference was detected in the logOn method of the Validator class.\n");
-                    }
-                }
-            })
+            logEnabled_ = true;)
     }
     //----------------------------------------------
     void logOff() override
@@ -301,15 +943,7 @@ public:
         IF_LOG_VALIDATOR_IS_ON(
             Class_Log::deInit();
             Class_Log::setLogOff();
-            for (auto it = fields_.begin(); it != fields_.end(); ++it) {
-                for (const FieldSchema &fieldSchema : it->second)
-                {
-                    if (&fieldSchema != nullptr)
-                    {
-                        const_cast<FieldSchema &>(fieldSchema).logOff();
-                    }
-                }
-            })
+            logEnabled_ = false;)
     }
     //----------------------------------------------
     // Add a field with multiple names
@@ -321,6 +955,7 @@ public:
             fields_[name].push_back(field); // Store the field for each name
             IF_LOG_VALIDATOR_IS_ON(log(COLOR_GREEN, TEXT_NORMAL, "Added field for name: %s\n", name.c_str());)
         }
+        rebuildKeys();
         return *this;
     }
 
@@ -331,6 +966,7 @@ public:
         // field.logOn(name.c_str());
         fields_[name].push_back(field); // Store the field for the single name
         IF_LOG_VALIDATOR_IS_ON(log(COLOR_GREEN, TEXT_NORMAL, "Added field for name: %s\n", name.c_str());)
+        rebuildKeys();
         return *this;
     }
 
@@ -340,9 +976,239 @@ public:
         // field.logOn(name.c_str());
         fields_[name].push_back(field); // Store the field for the single name
         IF_LOG_VALIDATOR_IS_ON(log(COLOR_GREEN, TEXT_NORMAL, "Added field for Json\n");)
+        rebuildKeys();
         return *this;
     }
     //----------------------------------------------
+    // Strict mode (JSON Schema additionalProperties=false): objects are validated by one walk over their
+    // members, each looked up with findKey(), and any member the schema does not know - or a key given
+    // twice - rejects the document. setMaxKeys() bounds the member count in the same walk; it can be used
+    // without strict mode. Non-object documents are unaffected. The walk tracks up to VALIDATOR_MAX_KEYS
+    // schema keys; with more, strict and maxKeys validators fail every object with TooManyKeys.
+    Validator &setStrict(bool strict)
+    {
+        strict_ = strict;
+        return *this;
+    }
+
+    Validator &setMaxKeys(uint16_t maxKeys)
+    {
+        maxKeys_ = maxKeys;
+        return *this;
+    }
+
+    bool isStrict() const
+    {
+        return strict_;
+    }
+
+    uint16_t maxKeys() const
+    {
+        return maxKeys_;
+    }
+    //----------------------------------------------
+    // Cross-field rules. Relations only apply when both keys are present (use setRequired for presence);
+    // ordering compares numbers with numbers and strings with strings, anything else violates the rule.
+    //   validator.addRelation("newPassword", FieldRelation::NotEqual, "currentPassword")
+    //            .addRelation("min", FieldRelation::Less, "max")
+    //            .addRequiredIf("port", "host")
+    //            .addMutuallyExclusive({"dhcp", "staticIp"});
+    Validator &addRelation(const String &left, FieldRelation relation, const String &right)
+    {
+        CrossFieldRule rule;
+        rule.kind = CrossFieldRule::Relation;
+        rule.relation = relation;
+        rule.slots.push_back(captureSlot(left));
+        rule.slots.push_back(captureSlot(right));
+        return addCrossFieldRule(rule);
+    }
+
+    // `name` must be present whenever `whenPresent` is
+    Validator &addRequiredIf(const String &name, const String &whenPresent)
+    {
+        CrossFieldRule rule;
+        rule.kind = CrossFieldRule::RequiredIf;
+        rule.relation = FieldRelation::Equal;
+        rule.slots.push_back(captureSlot(name));
+        rule.slots.push_back(captureSlot(whenPresent));
+        return addCrossFieldRule(rule);
+    }
+
+    // At most one of `names` may be present
+    Validator &addMutuallyExclusive(const std::vector<String> &names)
+    {
+        CrossFieldRule rule;
+        rule.kind = CrossFieldRule::MutuallyExclusive;
+        rule.relation = FieldRelation::Equal;
+        for (const String &name : names)
+            rule.slots.push_back(captureSlot(name));
+        return addCrossFieldRule(rule);
+    }
+
+    bool hasCrossFieldRules() const
+    {
+        return !crossRules_.empty();
+    }
+
+    // Number of capture slots a walk must provide to checkCrossFields()
+    size_t crossFieldKeys() const
+    {
+        return crossNames_.size();
+    }
+
+    // Evaluate every cross-field rule against the values captured by a walk (Absent where a key was
+    // not seen). Used by isValid and by the MessagePack/CBOR walk.
+    bool checkCrossFields(const CapturedValue *captured, ValidationContext &ctx) const
+    {
+        if (crossUnresolved_)
+        {
+            ctx.field = crossUnresolved_;
+            IF_LOG_VALIDATOR_IS_ON(log(COLOR_RED, TEXT_BOLD, "Cross-field rule uses key %s, which has no schema.\n", crossUnresolved_);)
+            return ctx.fail(ValidationError::CrossFieldViolation);
+        }
+        for (const CrossFieldRule &rule : crossRules_)
+        {
+            ctx.field = crossNames_[rule.slots[0]].c_str();
+            if (!crossFieldHolds(rule, captured))
+            {
+                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Cross-field rule on key %s does not hold.\n", ctx.field);)
+                return ctx.fail(rule.kind == CrossFieldRule::RequiredIf ? ValidationError::MissingRequired : ValidationError::CrossFieldViolation);
+            }
+        }
+        return true;
+    }
+    //----------------------------------------------
+    // Read-only view of the compiled fields, keyed by name ("" validates the whole document)
+    const std::map<String, std::vector<FieldSchema>> &fields() const
+    {
+        return fields_;
+    }
+    //----------------------------------------------
+    // FNV-1a over the key bytes; keys need not be NUL-terminated
+    static uint32_t hashKey(const char *key, size_t length)
+    {
+        uint32_t hash = 2166136261UL;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= (uint8_t)key[i];
+            hash *= 16777619UL;
+        }
+        return hash;
+    }
+    //----------------------------------------------
+    // Find the schemas for a key without allocating; nullptr if the key is not part of the schema.
+    const KeyEntry *findKey(const char *key, size_t length) const
+    {
+        uint32_t hash = hashKey(key, length);
+        auto it = std::lower_bound(keys_.begin(), keys_.end(), hash, [](const KeyEntry &entry, uint32_t h)
+                                   { return entry.hash < h; });
+        for (; it != keys_.end() && it->hash == hash; ++it)
+        {
+            if (it->length == length && memcmp(it->name, key, length) == 0)
+                return &*it;
+        }
+        return nullptr;
+    }
+    //----------------------------------------------
+    // Run the schemas of one key on a value: its MergedField when the schemas could be folded, otherwise
+    // each schema in turn.
+    bool validateKey(const KeyEntry &entry, const JsonVariant &value, ValidationContext &ctx) const
+    {
+        if (entry.merged >= 0)
+            return FieldSchema::validateRules(merged_[entry.merged].rules, merged_[entry.merged].patterns(), value, ctx);
+        for (const FieldSchema &schema : *entry.schemas)
+        {
+            if (!schema.validate(value, ctx))
+                return false;
+        }
+        return true;
+    }
+
+    const MergedField *mergedField(const KeyEntry &entry) const
+    {
+        return entry.merged >= 0 ? &merged_[entry.merged] : nullptr;
+    }
+    //----------------------------------------------
+    // Compiled keys in lookup order; the position of an entry is a stable per-validator key index.
+    const std::vector<KeyEntry> &keys() const
+    {
+        return keys_;
+    }
+    //----------------------------------------------
+    // Document sizing. documentCapacity() is an upper bound on the JsonDocument capacity an object accepted
+    // by this validator needs when parsed through buildFilter()'s filter, counting every schema key as
+    // present with its key copied and strings at their maxLength (encrypted ones at the hex ciphertext
+    // length of maxLength bytes), twice for strings normalised by setTrim/setCase (the normalised copy is
+    // stored as well). It is 0 when the schema does not bound the size: a string without maxLength or
+    // trimmed (only the trimmed length is bounded), an array without maxItems, a whole-document schema, or
+    // a non-strict setMaxKeys validator, whose bodies keep the members the schema does not know.
+    // Array elements are counted as numbers or booleans; arrays of strings or objects need
+    // `elementCapacity` extra bytes per element. A body larger than the bound fails deserialisation with
+    // NoMemory instead of growing the pool.
+    //   DynamicJsonDocument filter(validator.filterCapacity());
+    //   validator.buildFilter(filter);
+    //   DynamicJsonDocument doc(validator.documentCapacity());
+    //   deserializeJson(doc, body, DeserializationOption::Filter(filter));
+    size_t documentCapacity(size_t elementCapacity = 0) const
+    {
+        if (maxKeys_ && !strict_)
+            return 0; // unknown members are stored (no filter) and accepted
+        size_t total = JSON_OBJECT_SIZE(keys_.size());
+        for (const KeyEntry &entry : keys_)
+        {
+            if (entry.length == 0)
+                return 0;
+            size_t value = SIZE_MAX, copies = 1;
+            for (const FieldSchema &schema : *entry.schemas)
+            {
+                const FieldRules &rules = schema.getRules();
+                size_t bound = valueCapacity(rules, elementCapacity);
+                if (schema.getCipher() && rules.type == FieldType::String && bound != SIZE_MAX)
+                    bound = JSON_STRING_SIZE(2 * ((bound - 1) / 16 + 1) * 16); // hex of the PKCS7-padded plaintext
+                value = std::min(value, bound); // the value must pass every schema
+                if (rules.type == FieldType::String && (rules.transforms & (FieldRules::Trim | FieldRules::Lowercase | FieldRules::Uppercase)))
+                    ++copies; // the normalised copy is stored next to the original, which the pool never reclaims
+            }
+            if (value == SIZE_MAX)
+                return 0;
+            total += JSON_STRING_SIZE(entry.length) + copies * value;
+        }
+        return total;
+    }
+
+    // Same bound for isArrayValid() on an array of up to `maxElements` objects
+    size_t arrayCapacity(size_t maxElements, size_t elementCapacity = 0) const
+    {
+        size_t element = documentCapacity(elementCapacity);
+        return element ? JSON_ARRAY_SIZE(maxElements) + maxElements * element : 0;
+    }
+
+    size_t filterCapacity() const
+    {
+        size_t total = JSON_ARRAY_SIZE(1) + JSON_OBJECT_SIZE(keys_.size());
+        for (const KeyEntry &entry : keys_)
+            total += JSON_STRING_SIZE(entry.length);
+        return total;
+    }
+
+    // Fill `filter` so deserializeJson keeps only the schema keys (`asArray`: of every element of an array,
+    // for isArrayValid). Fails for strict and setMaxKeys validators, which must see unknown keys to reject
+    // them or count them, for whole-document schemas, and when `filter` is too small.
+    bool buildFilter(JsonDocument &filter, bool asArray = false) const
+    {
+        filter.clear();
+        if (strict_ || maxKeys_)
+            return false;
+        JsonObject keys = asArray ? filter.to<JsonArray>().createNestedObject() : filter.to<JsonObject>();
+        for (const KeyEntry &entry : keys_)
+        {
+            if (entry.length == 0)
+                return false;
+            keys[const_cast<char *>(entry.name)] = true; // char* key: copied, the filter may outlive a replaced validator
+        }
+        return !filter.overflowed();
+    }
+    //----------------------------------------------
     // Validate a set of fields in a JSON object
     // bool isValid(const JsonVariant &json) const
     // {
@@ -372,96 +1238,90 @@ public:
     //----------------------------------------------
     bool isValid(const JsonVariant &json) const
     {
-        for (auto it = fields_.begin(); it != fields_.end(); ++it)
+        ValidationContext ctx;
+        return isValid(json, ctx);
+    }
+    //----------------------------------------------
+    // Same as isValid(json) but reports the first failure (ctx.failedField / ctx.error) to the caller.
+    bool isValid(const JsonVariant &json, ValidationContext &ctx) const
+    {
+        ctx.logger = logEnabled_ ? this : nullptr;
+        CapturedValue captured[VALIDATOR_MAX_CROSS_KEYS];
+        size_t fieldIndex = 0;
+        if (!crossRules_.empty())
+            memset(captured, 0, sizeof(captured));
+
+        if ((strict_ || maxKeys_) && json.is<JsonObject>())
+        {
+            if (!isValidMembers(json, ctx, captured))
+                return false;
+            if (!crossRules_.empty() && !checkCrossFields(captured, ctx))
+                return false;
+            IF_LOG_VALIDATOR_IS_ON(log(COLOR_GREEN, TEXT_NORMAL, "Validation succeeded\n");)
+            return true;
+        }
+
+        for (auto it = fields_.begin(); it != fields_.end(); ++it, ++fieldIndex)
         {
             const String &name = it->first;
             const std::vector<FieldSchema> &fieldSchemas = it->second;
+            ctx.field = name.c_str();
 
-            if (json.containsKey(name))
+            if (name.isEmpty())
             {
-                // const JsonVariant &value = json[name];
-                // // IF_LOG_VALIDATOR_IS_ON(log(COLOR_BLUE, TEXT_NORMAL, "Found key: %s\n", name.c_str());)
-                // for (const FieldSchema &fieldSchema : fieldSchemas)
-                // {
-                //     if (!fieldSchema.validate(value))
-                //     {
-                //         // IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Validation failed for key: %s\n", name.c_str());)
-                //         return false; // Validation failed for this field
-                //     }
-                // }
-                const JsonVariant &value = json[name];
-                if (!std::all_of(fieldSchemas.begin(), fieldSchemas.end(), [&](const FieldSchema &schema)
-                                 { return schema.validate(value); }))
-                {
+                // Whole-document rules apply to the document itself, even if it has a "" member, as in
+                // the strict walk
+                const JsonVariant &value = json;
+                if (!validateKey(keys_[fieldKeys_[fieldIndex]], value, ctx))
                     return false; // Validation failed for this field
-                }
+                if (ctx.sink && !ctx.sink->accept(fieldKeys_[fieldIndex], value, ctx))
+                    return false;
             }
-            else if (name == "")
+            else if (json.containsKey(name))
             {
-                // const JsonVariant &value = json;
-                // // IF_LOG_VALIDATOR_IS_ON(log(COLOR_BLUE, TEXT_NORMAL, "Found Json\n");)
-                // for (const FieldSchema &fieldSchema : fieldSchemas)
-                // {
-                //     if (!fieldSchema.validate(value))
-                //     {
-                //         // IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Validation failed for Json);)
-                //         return false; // Validation failed for this field
-                //     }
-                // }
-                const JsonVariant &value = json;
-                if (!std::all_of(fieldSchemas.begin(), fieldSchemas.end(), [&](const FieldSchema &schema)
-                                 {
-                                     //-----
-                                     // IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Validation failed for Json);)
-                                     return schema.validate(value);
-                                     //-----
-                                 }))
-                {
+                const JsonVariant &value = json[name];
+                if (!validateKey(keys_[fieldKeys_[fieldIndex]], value, ctx))
                     return false; // Validation failed for this field
-                }
+                if (!crossRules_.empty() && fieldCaptures_[fieldIndex] >= 0)
+                    captured[fieldCaptures_[fieldIndex]] = CapturedValue::from(value);
+                if (ctx.sink && !ctx.sink->accept(fieldKeys_[fieldIndex], value, ctx))
+                    return false;
             }
-            // else
-            // {
-            //     // Check if the field is required and missing
-            //     for (const FieldSchema &fieldSchema : fieldSchemas)
-            //     {
-            //         if (fieldSchema.isRequired())
-            //         {
-            //             IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Required key %s is missing.\n", name.c_str());)
-            //             return false; // Field is required but missing
-            //         }
-            //     }
-            //     IF_LOG_VALIDATOR_IS_ON(log(COLOR_BLUE, TEXT_NORMAL, "Key %s not found in JSON.\n", name.c_str());)
-            // }
             else if (std::any_of(fieldSchemas.begin(), fieldSchemas.end(), [](const FieldSchema &schema)
-                                 {
-                                     //----
-                                     //  IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Required key %s is missing.\n", name.c_str());)
-                                     return schema.isRequired(); //----
-                                 }))
+                                 { return schema.isRequired(); }))
             {
                 IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Required key %s is missing.\n", name.c_str());)
-                return false; // Field is required but missing
+                return ctx.fail(ValidationError::MissingRequired); // Field is required but missing
             }
+            else if (keys_[fieldKeys_[fieldIndex]].defaulted && !applyDefault(json, keys_[fieldKeys_[fieldIndex]], fieldKeys_[fieldIndex], captured, ctx))
+                return false;
         }
+        if (!crossRules_.empty() && !checkCrossFields(captured, ctx))
+            return false;
         IF_LOG_VALIDATOR_IS_ON(log(COLOR_GREEN, TEXT_NORMAL, "Validation succeeded\n");)
         return true;
     }
     //----------------------------------------------
     bool isArrayValid(const JsonVariant &arrays) const
+    {
+        ValidationContext ctx;
+        return isArrayValid(arrays, ctx);
+    }
+    //----------------------------------------------
+    bool isArrayValid(const JsonVariant &arrays, ValidationContext &ctx) const
     {
         // Check if the input is a valid JSON array
         if (!arrays.is<JsonArray>())
         {
             IF_LOG_VALIDATOR_IS_ON(log(COLOR_RED, TEXT_BOLD, "Provided JsonVariant is not a JsonArray.\n");)
-            return false;
+            return ctx.fail(ValidationError::WrongType);
         }
 
         // Use range-based for loop directly on JsonArray
         size_t index = 0;
         for (const JsonVariant &array : arrays.as<JsonArray>())
         {
-            if (!isValid(array))
+            if (!isValid(array, ctx))
             {
                 // Log the index of the failing element
                 IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Validation failed for element at index %u in array.\n", index);)
@@ -474,6 +1334,323 @@ public:
         return true;
     }
     //----------------------------------------------
+private:
+    // Single pass over the object's members: O(members) lookups, then one sweep over keys_ for the
+    // required keys that were not seen and for whole-document rules.
+    bool isValidMembers(const JsonVariant &json, ValidationContext &ctx, CapturedValue *captured) const
+    {
+        if (keys_.size() > VALIDATOR_MAX_KEYS)
+        {
+            // The walk cannot track every key, so it fails closed rather than skip any
+            IF_LOG_VALIDATOR_IS_ON(log(COLOR_RED, TEXT_BOLD, "Schema has more than %d keys.\n", VALIDATOR_MAX_KEYS);)
+            return ctx.fail(ValidationError::TooManyKeys);
+        }
+
+        uint32_t seen[(VALIDATOR_MAX_KEYS + 31) / 32] = {0};
+        size_t members = 0;
+        for (JsonPair member : json.as<JsonObject>())
+        {
+            const char *key = member.key().c_str();
+            ctx.field = key;
+            if (maxKeys_ && ++members > maxKeys_)
+            {
+                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Object has more than %u keys.\n", (unsigned)maxKeys_);)
+                return ctx.fail(ValidationError::TooManyKeys);
+            }
+
+            size_t length = strlen(key);
+            const KeyEntry *entry = length ? findKey(key, length) : nullptr; // "" is the whole-document entry, not a member
+            if (entry == nullptr)
+            {
+                if (!strict_)
+                    continue;
+                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Unknown key %s.\n", key);)
+                return ctx.fail(ValidationError::UnknownKey);
+            }
+
+            size_t index = entry - keys_.data();
+            if (seen[index / 32] & (1UL << (index % 32)))
+            {
+                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Duplicate key %s.\n", key);)
+                return ctx.fail(ValidationError::UnknownKey);
+            }
+            seen[index / 32] |= 1UL << (index % 32);
+
+            ctx.field = entry->name;
+            JsonVariant value = member.value();
+            if (!validateKey(*entry, value, ctx))
+                return false;
+            if (entry->capture >= 0)
+                captured[entry->capture] = CapturedValue::from(value);
+            if (ctx.sink && !ctx.sink->accept(index, value, ctx))
+                return false;
+        }
+
+        for (size_t index = 0; index < keys_.size(); ++index)
+        {
+            const KeyEntry &entry = keys_[index];
+            if (seen[index / 32] & (1UL << (index % 32)))
+                continue;
+            ctx.field = entry.name;
+            if (entry.length == 0)
+            {
+                if (!validateKey(entry, json, ctx))
+                    return false;
+                if (ctx.sink && !ctx.sink->accept(index, json, ctx))
+                    return false;
+            }
+            else if (entry.required)
+            {
+                IF_LOG_VALIDATOR_IS_ON(log(COLOR_YELLOW, TEXT_BOLD, "Required key %s is missing.\n", entry.name);)
+                return ctx.fail(ValidationError::MissingRequired);
+            }
+            else if (entry.defaulted && !applyDefault(json, entry, index, captured, ctx))
+                return false;
+        }
+        return true;
+    }
+
+    // Missing optional key with a default: the first schema's default goes to the sink when there is one,
+    // otherwise it is added to the object. Non-object documents get no defaults.
+    bool applyDefault(const JsonVariant &json, const KeyEntry &entry, size_t index, CapturedValue *captured, ValidationContext &ctx) const
+    {
+        if (!json.is<JsonObject>())
+            return true;
+        for (const FieldSchema &schema : *entry.schemas)
+        {
+            if (!schema.hasDefault())
+                continue;
+            JsonVariant value = schema.getDefault();
+            if (ctx.sink)
+            {
+                if (!ctx.sink->accept(index, value, ctx))
+                    return false;
+            }
+            else if (!json[const_cast<char *>(entry.name)].set(value)) // char* key: copied into the pool
+            {
+                IF_LOG_VALIDATOR_IS_ON(log(COLOR_RED, TEXT_BOLD, "No room for the default of key %s.\n", entry.name);)
+                return ctx.fail(ValidationError::NoCapacity);
+            }
+            if (entry.capture >= 0)
+                captured[entry.capture] = CapturedValue::from(value);
+            return true;
+        }
+        return true;
+    }
+
+    void rebuildKeys()
+    {
+        keys_.clear();
+        keys_.reserve(fields_.size());
+        merged_.clear();
+        fieldCaptures_.clear();
+        std::vector<bool> resolved(crossNames_.size(), false);
+        for (auto it = fields_.begin(); it != fields_.end(); ++it)
+        {
+            KeyEntry entry;
+            entry.hash = hashKey(it->first.c_str(), it->first.length());
+            entry.length = it->first.length();
+            entry.required = std::any_of(it->second.begin(), it->second.end(), [](const FieldSchema &schema)
+                                         { return schema.isRequired(); });
+            entry.defaulted = std::any_of(it->second.begin(), it->second.end(), [](const FieldSchema &schema)
+                                          { return schema.hasDefault(); });
+            entry.capture = -1;
+            for (size_t slot = 0; slot < crossNames_.size(); ++slot)
+            {
+                if (crossNames_[slot] == it->first && !it->first.isEmpty() && slot < VALIDATOR_MAX_CROSS_KEYS)
+                {
+                    entry.capture = slot;
+                    resolved[slot] = true;
+                }
+            }
+            entry.field = keys_.size();
+            entry.merged = -1;
+            MergedField merged;
+            if (merged_.size() < INT16_MAX && mergeSchemas(it->second, merged))
+            {
+                entry.merged = merged_.size();
+                merged_.push_back(merged);
+            }
+            entry.name = it->first.c_str();
+            entry.schemas = &it->second;
+            keys_.push_back(entry);
+            fieldCaptures_.push_back(entry.capture);
+        }
+        std::sort(keys_.begin(), keys_.end(), [](const KeyEntry &a, const KeyEntry &b)
+                  { return a.hash < b.hash; });
+        fieldKeys_.assign(keys_.size(), 0);
+        for (size_t index = 0; index < keys_.size(); ++index)
+            fieldKeys_[keys_[index].field] = index;
+
+        crossUnresolved_ = nullptr;
+        for (size_t slot = 0; slot < crossNames_.size() && !crossUnresolved_; ++slot)
+        {
+            if (!resolved[slot] || slot >= VALIDATOR_MAX_CROSS_KEYS)
+                crossUnresolved_ = crossNames_[slot].c_str();
+        }
+    }
+
+    // Fold a key's schemas into one rule set. Keys whose schemas disagree on type or normalisation, clamp
+    // (clamping to one range and checking another does not commute), measure length in different units,
+    // carry a broken pattern or are encrypted keep running schema by schema.
+    static bool mergeSchemas(const std::vector<FieldSchema> &schemas, MergedField &out)
+    {
+        if (schemas.size() < 2)
+            return false;
+        const FieldRules &first = schemas.front().getRules();
+        FieldRules rules = {first.type, 0, first.transforms, -FLT_MAX, FLT_MAX, 0, INT32_MAX, 0, INT32_MAX, 0};
+        bool codePoints = false, bytes = false;
+        std::vector<const String *> sources; // pattern text per program, to drop repeats
+        for (const FieldSchema &schema : schemas)
+        {
+            const FieldRules &r = schema.getRules();
+            if (schema.hasPatternError() || schema.getCipher() || r.type != rules.type || r.transforms != rules.transforms || r.has(FieldRules::Clamp))
+                return false;
+            rules.flags |= r.flags & (FieldRules::Required | FieldRules::Utf8);
+            if (r.has(FieldRules::ValueConstraints))
+            {
+                rules.flags |= FieldRules::ValueConstraints;
+                rules.minValue = std::max(rules.minValue, r.minValue);
+                rules.maxValue = std::min(rules.maxValue, r.maxValue);
+            }
+            if (r.has(FieldRules::LengthConstraints))
+            {
+                (r.has(FieldRules::CodePoints) ? codePoints : bytes) = true;
+                rules.flags |= FieldRules::LengthConstraints;
+                rules.minLength = std::max(rules.minLength, r.minLength);
+                rules.maxLength = std::min(rules.maxLength, r.maxLength);
+            }
+            if (r.has(FieldRules::ItemsConstraints))
+            {
+                rules.flags |= FieldRules::ItemsConstraints;
+                rules.minItems = std::max(rules.minItems, r.minItems);
+                rules.maxItems = std::min(rules.maxItems, r.maxItems);
+            }
+            if (r.has(FieldRules::Pattern))
+            {
+                rules.flags |= FieldRules::Pattern;
+                auto same = std::find_if(sources.begin(), sources.end(), [&](const String *text)
+                                         { return *text == schema.getPattern(); });
+                if (same != sources.end())
+                {
+                    uint32_t &budget = out.budgets[same - sources.begin()];
+                    budget = std::min(budget, FieldSchema::stepBudget(r));
+                    continue;
+                }
+                sources.push_back(&schema.getPattern());
+                out.programs.push_back(*schema.getPatternProgram());
+                out.budgets.push_back(FieldSchema::stepBudget(r));
+            }
+        }
+        if (codePoints && bytes)
+            return false;
+        if (codePoints)
+            rules.flags |= FieldRules::CodePoints;
+        out.rules = rules;
+        return true;
+    }
+
+    // Pool bytes one value needs beyond its slot, SIZE_MAX when the rules do not bound it
+    static size_t valueCapacity(const FieldRules &rules, size_t elementCapacity)
+    {
+        switch (rules.type)
+        {
+        case FieldType::Boolean:
+        case FieldType::Integer:
+        case FieldType::Float:
+            return 0;
+        case FieldType::String:
+            if (rules.has(FieldRules::Trim))
+                break; // maxLength applies after trimming; the raw value can be any length
+            if (rules.has(FieldRules::LengthConstraints) && rules.maxLength >= 0)
+                return JSON_STRING_SIZE(rules.has(FieldRules::CodePoints) ? 4 * (size_t)rules.maxLength : rules.maxLength);
+            break;
+        case FieldType::Array:
+            if (rules.has(FieldRules::ItemsConstraints) && rules.maxItems >= 0)
+                return JSON_ARRAY_SIZE(rules.maxItems) + rules.maxItems * elementCapacity;
+            break;
+        default:
+            break;
+        }
+        return SIZE_MAX;
+    }
+
+    uint8_t captureSlot(const String &name)
+    {
+        for (size_t slot = 0; slot < crossNames_.size(); ++slot)
+        {
+            if (crossNames_[slot] == name)
+                return slot;
+        }
+        crossNames_.push_back(name);
+        return std::min<size_t>(crossNames_.size() - 1, 255);
+    }
+
+    Validator &addCrossFieldRule(const CrossFieldRule &rule)
+    {
+        crossRules_.push_back(rule);
+        rebuildKeys();
+        return *this;
+    }
+
+    static bool crossFieldHolds(const CrossFieldRule &rule, const CapturedValue *captured)
+    {
+        switch (rule.kind)
+        {
+        case CrossFieldRule::RequiredIf:
+            return captured[rule.slots[1]].kind == CapturedValue::Absent || captured[rule.slots[0]].kind != CapturedValue::Absent;
+        case CrossFieldRule::MutuallyExclusive:
+        {
+            int present = 0;
+            for (uint8_t slot : rule.slots)
+                present += captured[slot].kind != CapturedValue::Absent;
+            return present <= 1;
+        }
+        default:
+            break;
+        }
+
+        const CapturedValue &a = captured[rule.slots[0]];
+        const CapturedValue &b = captured[rule.slots[1]];
+        if (a.kind == CapturedValue::Absent || b.kind == CapturedValue::Absent)
+            return true;
+        if (a.kind == CapturedValue::Other || b.kind == CapturedValue::Other)
+            return false;
+
+        bool equality = rule.relation == FieldRelation::Equal || rule.relation == FieldRelation::NotEqual;
+        if (a.kind != b.kind)
+            return rule.relation == FieldRelation::NotEqual;
+        if (!equality && a.kind != CapturedValue::Number && a.kind != CapturedValue::String)
+            return false; // only numbers and strings are ordered
+
+        int order;
+        if (a.kind == CapturedValue::String)
+        {
+            order = memcmp(a.str, b.str, std::min(a.length, b.length));
+            if (order == 0)
+                order = a.length < b.length ? -1 : a.length > b.length;
+        }
+        else
+            order = a.number < b.number ? -1 : a.number > b.number;
+
+        switch (rule.relation)
+        {
+        case FieldRelation::Equal:
+            return order == 0;
+        case FieldRelation::NotEqual:
+            return order != 0;
+        case FieldRelation::Less:
+            return order < 0;
+        case FieldRelation::LessOrEqual:
+            return order <= 0;
+        case FieldRelation::Greater:
+            return order > 0;
+        case FieldRelation::GreaterOrEqual:
+            return order >= 0;
+        }
+        return false;
+    }
+    //----------------------------------------------
 };
 // bool isValid(const JsonVariant &json) const
 // {
@@ -0,0 +1,31 @@
+#ifndef PAT_fieldCipher_H
+#define PAT_fieldCipher_H
+#include <Arduino.h>
+
+//===========================================================================================================================================
+// Field cipher
+//
+// Decrypts an encrypted body field so FieldSchema can validate the plaintext (FieldSchema::setEncrypted).
+// The validator hands in a scratch buffer of its own and wipes it afterwards; implementations must not
+// keep the plaintext anywhere else and must be callable from several tasks at once. AESLibrary
+// (PAT_AES.h) implements it for the hex ciphertext produced by AESLibrary::encrypt.
+//-------------------------------------------------------------------
+class FieldCipher
+{
+public:
+    // Plaintext length written to `out`, or -1 when `ciphertext` is malformed or does not fit `capacity`
+    virtual int decrypt(const char *ciphertext, size_t length, uint8_t *out, size_t capacity) const = 0;
+
+    // Overwrite plaintext in a way the compiler cannot drop as a dead store
+    static void wipe(void *data, size_t size)
+    {
+        volatile uint8_t *p = (volatile uint8_t *)data;
+        while (size--)
+            *p++ = 0;
+    }
+
+protected:
+    ~FieldCipher() = default;
+};
+
+#endif // PAT_fieldCipher_H
@@ -0,0 +1,322 @@
+#ifndef PAT_headerMatcher_H
+#define PAT_headerMatcher_H
+#include <Arduino.h>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "PAT_dataValidator.h"
+
+//===========================================================================================================================================
+// Request header checks
+//
+// An endpoint's header requirements (APIBuilder::setHeader / setContentType) compiled into a table sorted
+// by the FNV-1a hash of the lower-cased header name, like the Validator's key lookup. check() walks the
+// incoming headers once: each name is hashed while its case is folded, looked up without allocating,
+// compared case-insensitively (RFC 9110) and its value checked on the spot. A final sweep over the rules
+// reports required headers that never arrived. Values are checked as the server delivers them; HTTP
+// parsers strip the surrounding whitespace.
+//
+//   HeaderView incoming[] = {{"Content-Type", 12, "application/json", 16}, {"X-Api-Key", 9, key, keyLength}};
+//   ValidationContext ctx;
+//   if (!changePassword.load().checkHeaders(incoming, 2, ctx))
+//       reply 400 with ctx.failedField;
+//
+// Failures: MissingRequired, UnknownKey (a checked header sent twice), PatternMismatch (setHeader value
+// or content type differs), or what the header's FieldSchema reports. A rule beyond
+// HEADER_MATCHER_MAX_RULES is refused when it is added and hasTooManyRules() turns true; since the
+// endpoint then lacks one of its checks, check() fails every request with TooManyKeys.
+//-------------------------------------------------------------------
+#ifndef HEADER_MATCHER_MAX_RULES
+#define HEADER_MATCHER_MAX_RULES 32 // Header rules per endpoint (stack bitmap)
+#endif
+
+// One incoming header; neither string needs to be NUL-terminated
+struct HeaderView
+{
+    const char *name;
+    size_t nameLength;
+    const char *value;
+    size_t valueLength;
+};
+
+class HeaderMatcher
+{
+public:
+    enum class Kind : uint8_t
+    {
+        Present,   // Any value
+        Equals,    // Exact, case-sensitive value
+        MediaType, // Content-Type: media type compared case-insensitively, parameters after ';' ignored
+        Schema,    // FieldSchema rules on the value text
+    };
+
+    struct Rule
+    {
+        uint32_t hash; // FNV-1a of the lower-cased name
+        Kind kind;
+        bool required;
+        String name;  // Lower-cased
+        String value; // Equals, MediaType
+        FieldSchema schema;
+    };
+
+private:
+    std::vector<Rule> rules_; // Sorted by hash
+    bool tooManyRules_ = false;
+
+public:
+    //----------------------------------------------
+    // A later rule for the same header name replaces the earlier one.
+    // Header that must be present; with a value, it must be exactly that value.
+    HeaderMatcher &require(const String &name, const String &value = "")
+    {
+        return addRule(name, value.isEmpty() ? Kind::Present : Kind::Equals, true, value, FieldSchema());
+    }
+
+    // Content-Type must name this media type ("application/json" accepts "Application/JSON; charset=utf-8")
+    HeaderMatcher &requireContentType(const String &mediaType)
+    {
+        return addRule("content-type", Kind::MediaType, true, mediaType, FieldSchema());
+    }
+
+    // FieldSchema rules on the header value: string rules on the raw text, integer/float/boolean types
+    // on the text parsed as a number or "true"/"false". The header is required if the schema is.
+    HeaderMatcher &add(const String &name, const FieldSchema &schema)
+    {
+        return addRule(name, Kind::Schema, schema.isRequired(), "", schema);
+    }
+
+    const std::vector<Rule> &rules() const
+    {
+        return rules_;
+    }
+
+    bool empty() const
+    {
+        return rules_.empty();
+    }
+
+    // A rule was refused because the matcher already held HEADER_MATCHER_MAX_RULES
+    bool hasTooManyRules() const
+    {
+        return tooManyRules_;
+    }
+    //----------------------------------------------
+    bool check(const HeaderView *headers, size_t count, ValidationContext &ctx) const
+    {
+        uint32_t seen[(HEADER_MATCHER_MAX_RULES + 31) / 32] = {0};
+        if (!begin(ctx))
+            return false;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!checkHeader(headers[i].name, headers[i].nameLength, headers[i].value, headers[i].valueLength, seen, ctx))
+                return false;
+        }
+        return checkMissing(seen, ctx);
+    }
+
+    // Any container of name/value pairs with c_str() and length(), e.g. APIStruct::headers
+    template <typename Headers>
+    bool check(const Headers &headers, ValidationContext &ctx) const
+    {
+        uint32_t seen[(HEADER_MATCHER_MAX_RULES + 31) / 32] = {0};
+        if (!begin(ctx))
+            return false;
+        for (const auto &header : headers)
+        {
+            if (!checkHeader(header.first.c_str(), header.first.length(), header.second.c_str(), header.second.length(), seen, ctx))
+                return false;
+        }
+        return checkMissing(seen, ctx);
+    }
+    //----------------------------------------------
+    // FNV-1a over the ASCII-lower-cased name
+    static uint32_t hashName(const char *name, size_t length)
+    {
+        uint32_t hash = 2166136261UL;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= foldCase((uint8_t)name[i]);
+            hash *= 16777619UL;
+        }
+        return hash;
+    }
+
+    // Rule for a header name in any case, nullptr if the endpoint does not check it
+    const Rule *findRule(const char *name, size_t length) const
+    {
+        uint32_t hash = hashName(name, length);
+        auto it = std::lower_bound(rules_.begin(), rules_.end(), hash, [](const Rule &rule, uint32_t h)
+                                   { return rule.hash < h; });
+        for (; it != rules_.end() && it->hash == hash; ++it)
+        {
+            if (it->name.length() == length && equalsFolded(it->name.c_str(), name, length))
+                return &*it;
+        }
+        return nullptr;
+    }
+
+private:
+    static uint8_t foldCase(uint8_t c)
+    {
+        return (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+    }
+
+    // `lower` is already lower-cased
+    static bool equalsFolded(const char *lower, const char *text, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            if ((uint8_t)lower[i] != foldCase((uint8_t)text[i]))
+                return false;
+        }
+        return true;
+    }
+
+    HeaderMatcher &addRule(const String &name, Kind kind, bool required, const String &value, const FieldSchema &schema)
+    {
+        String lower = name;
+        lower.toLowerCase();
+        Rule rule = {hashName(lower.c_str(), lower.length()), kind, required, lower, value, schema};
+        if (kind == Kind::MediaType)
+            rule.value.toLowerCase();
+
+        auto same = std::find_if(rules_.begin(), rules_.end(), [&](const Rule &r)
+                                 { return r.name == lower; });
+        if (same != rules_.end())
+            *same = rule;
+        else if (rules_.size() < HEADER_MATCHER_MAX_RULES)
+            rules_.push_back(rule);
+        else
+        {
+            tooManyRules_ = true;
+            return *this;
+        }
+        std::sort(rules_.begin(), rules_.end(), [](const Rule &a, const Rule &b)
+                  { return a.hash < b.hash; });
+        return *this;
+    }
+
+    bool begin(ValidationContext &ctx) const
+    {
+        if (tooManyRules_)
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_RED, TEXT_BOLD, "More than %d header rules; one was refused.\n", HEADER_MATCHER_MAX_RULES);)
+            return ctx.fail(ValidationError::TooManyKeys);
+        }
+        return true;
+    }
+
+    bool checkHeader(const char *name, size_t nameLength, const char *value, size_t valueLength, uint32_t *seen, ValidationContext &ctx) const
+    {
+        const Rule *rule = findRule(name, nameLength);
+        if (rule == nullptr)
+            return true; // Headers the endpoint does not check
+        size_t index = rule - rules_.data();
+        ctx.field = rule->name.c_str();
+        if (seen[index / 32] & (1UL << (index % 32)))
+        {
+            IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "Duplicate header %s.\n", ctx.field);)
+            return ctx.fail(ValidationError::UnknownKey);
+        }
+        seen[index / 32] |= 1UL << (index % 32);
+        return checkValue(*rule, value, valueLength, ctx);
+    }
+
+    bool checkMissing(const uint32_t *seen, ValidationContext &ctx) const
+    {
+        for (size_t index = 0; index < rules_.size(); ++index)
+        {
+            if (rules_[index].required && !(seen[index / 32] & (1UL << (index % 32))))
+            {
+                ctx.field = rules_[index].name.c_str();
+                IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "Required header %s is missing.\n", ctx.field);)
+                return ctx.fail(ValidationError::MissingRequired);
+            }
+        }
+        return true;
+    }
+
+    static bool checkValue(const Rule &rule, const char *value, size_t length, ValidationContext &ctx)
+    {
+        switch (rule.kind)
+        {
+        case Kind::Present:
+            return true;
+        case Kind::Equals:
+            if (rule.value.length() == length && memcmp(rule.value.c_str(), value, length) == 0)
+                return true;
+            break;
+        case Kind::MediaType:
+        {
+            size_t end = 0;
+            while (end < length && value[end] != ';')
+                ++end;
+            while (end > 0 && (value[end - 1] == ' ' || value[end - 1] == '\t'))
+                --end;
+            if (rule.value.length() == end && equalsFolded(rule.value.c_str(), value, end))
+                return true;
+            break;
+        }
+        case Kind::Schema:
+            return checkSchema(rule.schema, value, length, ctx);
+        }
+        IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "Header %s has an unexpected value.\n", ctx.field);)
+        return ctx.fail(ValidationError::PatternMismatch);
+    }
+
+    static bool checkSchema(const FieldSchema &schema, const char *value, size_t length, ValidationContext &ctx)
+    {
+        if (schema.hasPatternError())
+            return ctx.fail(ValidationError::PatternInvalid);
+        const FieldRules &rules = schema.getRules();
+        ++ctx.fieldsChecked;
+        switch (rules.type)
+        {
+        case FieldType::String:
+        {
+            uint32_t budget = FieldSchema::stepBudget(rules);
+            PatternSet patterns = {schema.getPatternProgram(), &budget, rules.has(FieldRules::Pattern) ? 1u : 0u};
+            if (schema.getCipher())
+                return FieldSchema::checkEncrypted(rules, patterns, *schema.getCipher(), value, length, ctx);
+            return FieldSchema::checkString(rules, patterns, value, length, ctx);
+        }
+        case FieldType::Boolean:
+            if ((length == 4 && memcmp(value, "true", 4) == 0) || (length == 5 && memcmp(value, "false", 5) == 0))
+                return true;
+            break;
+        case FieldType::Integer:
+        case FieldType::Float:
+        {
+            char text[32]; // Header values are not NUL-terminated; numbers fit easily
+            if (length == 0 || length >= sizeof(text))
+                break;
+            memcpy(text, value, length);
+            text[length] = '\0';
+            char *end = nullptr;
+            if (rules.type == FieldType::Integer)
+            {
+                long long number = strtoll(text, &end, 10); // 64-bit, so overflow cannot wrap into int range
+                if (end == text + length && number >= INT_MIN && number <= INT_MAX)
+                    return FieldSchema::checkInteger(rules, (int)number, ctx);
+            }
+            else
+            {
+                float number = strtof(text, &end);
+                if (end == text + length && std::isfinite(number))
+                    return FieldSchema::checkFloat(rules, number, ctx);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        IF_LOG_VALIDATOR_IS_ON(LOG_VALIDATION_CONTEXT(ctx, COLOR_YELLOW, TEXT_BOLD, "[%s] header value has the wrong type.\n", ctx.field);)
+        return ctx.fail(ValidationError::WrongType);
+    }
+};
+
+#endif // PAT_headerMatcher_H
@@ -0,0 +1,575 @@
+#ifndef PAT_payloadGenerator_H
+#define PAT_payloadGenerator_H
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <vector>
+#include "PAT_dataValidator.h"
+#include "PAT_APIConfig.h"
+
+//===========================================================================================================================================
+// Synthetic payloads
+//
+// Builds request bodies from a Validator's compiled keys for load tests: valid documents, and documents
+// that break exactly one rule of one key (the target), so a test knows which check has to reject them.
+//   - Strings get a length in [minLength, maxLength]. A pattern is followed by a random walk through its
+//     compiled program; patterns with backreferences or lookaheads need setSample().
+//   - Numbers and item counts stay inside their ranges. Boundary puts every bounded value on a limit.
+//   - Encrypted fields (setEncrypted) are generated as plaintext and passed through setEncryptor().
+//   - setTargetSize() pads objects with unknown "_pad<n>" keys, unless the validator is strict or limits
+//     its key count.
+// Every payload is checked against the validator before generate() returns it: a Valid one must pass,
+// an invalid one must fail on its target. generate() returns false when the schema has no key the case
+// can target, or no labelled payload came out of PAYLOAD_GENERATOR_ATTEMPTS tries (cross-field rules the
+// generator does not model, for example). The validator must outlive the generator.
+//
+//   PayloadGenerator gen(api.load());
+//   gen.setEncryptor([](const String &plain) { return aes.encryptField(plain); });
+//   PayloadGenerator::Payload p;
+//   if (gen.generate(PayloadCase::LongString, p))  -> p.body, p.target, p.valid == false
+//-------------------------------------------------------------------
+#ifndef PAYLOAD_GENERATOR_ATTEMPTS
+#define PAYLOAD_GENERATOR_ATTEMPTS 32 // Tries per payload before generate() gives up
+#endif
+#ifndef PAYLOAD_GENERATOR_NESTING
+#define PAYLOAD_GENERATOR_NESTING 64 // Array depth of DeepNesting values (ArduinoJson's limit is 10)
+#endif
+
+enum class PayloadCase : uint8_t
+{
+    Valid = 0,
+    Boundary,        // Valid, every bounded value on one of its limits
+    ShortString,     // minLength - 1
+    LongString,      // maxLength + 1
+    PatternNearMiss, // A pattern-matching string with one character changed
+    ValueBelow,      // Below minValue
+    ValueAbove,      // Above maxValue
+    WrongType,       // A value of another JSON type
+    MissingRequired, // A required key left out
+    OversizedArray,  // maxItems + 1 elements
+    DeepNesting,     // The value replaced by PAYLOAD_GENERATOR_NESTING nested arrays; rejected by the parser, not the validator
+};
+
+class PayloadGenerator
+{
+public:
+    struct Payload
+    {
+        String body;
+        PayloadCase kind = PayloadCase::Valid;
+        bool valid = true;            // What the validator must answer
+        const char *target = nullptr; // Key the invalid case was aimed at, points into the validator
+    };
+
+private:
+    // What the generator needs from one compiled key
+    struct KeyPlan
+    {
+        const Validator::KeyEntry *entry;
+        const MergedField *merged;  // Folded rules when the validator merged the key's schemas
+        const FieldSchema *schema;  // Otherwise the schema values are generated from
+        const FieldCipher *cipher;  // Some schema of the key is encrypted
+    };
+
+    const Validator &validator_;
+    bool arrayBody_;
+    size_t arrayElements_ = 4;
+    size_t targetSize_ = 0;
+    size_t unboundedLength_ = 16;
+    uint32_t state_;
+    std::vector<KeyPlan> plans_;
+    std::map<String, String> samples_;
+    std::function<String(const String &)> encryptor_;
+
+public:
+    explicit PayloadGenerator(const Validator &validator, bool arrayBody = false, uint32_t seed = 1)
+        : validator_(validator), arrayBody_(arrayBody), state_(seed ? seed : 1)
+    {
+        for (const Validator::KeyEntry &entry : validator.keys())
+        {
+            if (entry.length == 0)
+                continue; // Whole-document schema, nothing to generate
+            KeyPlan plan = {&entry, validator.mergedField(entry), &entry.schemas->front(), nullptr};
+            for (const FieldSchema &schema : *entry.schemas)
+            {
+                if (schema.getCipher())
+                {
+                    plan.schema = &schema;
+                    plan.cipher = schema.getCipher();
+                }
+            }
+            plans_.push_back(plan);
+        }
+    }
+
+    // The endpoint's object body, or its array body when it only has an array validator
+    explicit PayloadGenerator(const APIStruct &api, uint32_t seed = 1)
+        : PayloadGenerator(api.hasValidator || !api.hasArrayValidator ? api.bodyValid : api.bodyArrayValid,
+                           !api.hasValidator && api.hasArrayValidator, seed)
+    {
+    }
+
+    // Wire value used for a string key instead of generating one (patterns the walk cannot follow)
+    PayloadGenerator &setSample(const String &key, const String &value)
+    {
+        samples_[key] = value;
+        return *this;
+    }
+
+    // Turns generated plaintext into the wire form of encrypted fields (e.g. AESLibrary::encrypt)
+    PayloadGenerator &setEncryptor(std::function<String(const String &)> encryptor)
+    {
+        encryptor_ = encryptor;
+        return *this;
+    }
+
+    // Approximate body size in bytes, reached with unknown padding keys; 0 = no padding
+    PayloadGenerator &setTargetSize(size_t bytes)
+    {
+        targetSize_ = bytes;
+        return *this;
+    }
+
+    // Objects per array body
+    PayloadGenerator &setArrayElements(size_t elements)
+    {
+        arrayElements_ = elements ? elements : 1;
+        return *this;
+    }
+
+    // Length of strings without maxLength
+    PayloadGenerator &setUnboundedLength(size_t length)
+    {
+        unboundedLength_ = length;
+        return *this;
+    }
+
+    //----------------------------------------------
+    bool generate(PayloadCase kind, Payload &out)
+    {
+        std::vector<size_t> targets;
+        if (kind != PayloadCase::Valid && kind != PayloadCase::Boundary)
+        {
+            for (size_t i = 0; i < plans_.size(); ++i)
+            {
+                if (canTarget(plans_[i], kind))
+                    targets.push_back(i);
+            }
+            if (targets.empty())
+                return false;
+        }
+
+        for (int attempt = 0; attempt < PAYLOAD_GENERATOR_ATTEMPTS; ++attempt)
+        {
+            const KeyPlan *target = targets.empty() ? nullptr : &plans_[targets[next() % targets.size()]];
+            size_t targetElement = arrayBody_ ? next() % arrayElements_ : 0;
+            String body;
+            bool built = true;
+            if (arrayBody_)
+            {
+                body += '[';
+                for (size_t e = 0; e < arrayElements_ && built; ++e)
+                {
+                    if (e)
+                        body += ',';
+                    built = writeObject(body, kind, e == targetElement ? target : nullptr, targetSize_ / arrayElements_);
+                }
+                body += ']';
+            }
+            else
+                built = writeObject(body, kind, target, targetSize_);
+
+            if (!built)
+                continue;
+            bool valid = kind == PayloadCase::Valid || kind == PayloadCase::Boundary;
+            if (!labelHolds(body, kind, valid, target))
+                continue;
+            out.body = body;
+            out.kind = kind;
+            out.valid = valid;
+            out.target = target ? target->entry->name : nullptr;
+            return true;
+        }
+        return false;
+    }
+
+    static const char *caseName(PayloadCase kind)
+    {
+        static const char *const names[] = {"valid", "boundary", "short_string", "long_string", "pattern_near_miss", "value_below",
+                                            "value_above", "wrong_type", "missing_required", "oversized_array", "deep_nesting"};
+        return (size_t)kind < sizeof(names) / sizeof(names[0]) ? names[(size_t)kind] : "?";
+    }
+
+    //----------------------------------------------
+    // Random walk through a compiled pattern toward `target` bytes: each Split prefers its first branch
+    // while the string is short. Assertions are not evaluated, so the result must still be checked.
+    // False on backreferences and lookaheads.
+    template <typename Random>
+    static bool synthesize(const PatRegexView &program, size_t target, Random &random, String &out)
+    {
+        out = "";
+        uint32_t pc = 0;
+        for (size_t steps = 0; steps < 8 * target + 256 && pc < program.instCount; ++steps)
+        {
+            const PatRegexInst &i = program.insts[pc];
+            switch (i.op)
+            {
+            case PatRegexOp::Match:
+                return true;
+            case PatRegexOp::Char:
+                out += (char)i.arg;
+                ++pc;
+                break;
+            case PatRegexOp::Class:
+            {
+                int c = pickFromClass(program.classes[i.x], random());
+                if (c < 0)
+                    return false;
+                out += (char)c;
+                ++pc;
+                break;
+            }
+            case PatRegexOp::Any:
+                out += (char)('a' + random() % 26);
+                ++pc;
+                break;
+            case PatRegexOp::Split:
+                pc = (random() % 4 < (out.length() < target ? 3u : 1u)) ? i.x : i.y;
+                break;
+            case PatRegexOp::Jmp:
+                pc = i.x;
+                break;
+            case PatRegexOp::Backref:
+            case PatRegexOp::Look:
+            case PatRegexOp::LookEnd:
+                return false;
+            default: // Save, Mark, Progress and assertions
+                ++pc;
+                break;
+            }
+        }
+        return false;
+    }
+
+private:
+    // xorshift32: reproducible from the seed, no global state
+    uint32_t next()
+    {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+
+    uint32_t operator()()
+    {
+        return next();
+    }
+
+    // A printable member of the class when there is one
+    static int pickFromClass(const PatRegexClass &set, uint32_t random)
+    {
+        int printable = 0, any = 0;
+        for (int c = 0; c < 256; ++c)
+        {
+            if (set.test(c))
+            {
+                ++any;
+                printable += c >= 0x20 && c < 0x7F;
+            }
+        }
+        if (any == 0)
+            return -1;
+        bool wantPrintable = printable > 0;
+        int pick = random % (wantPrintable ? printable : any);
+        for (int c = 0; c < 256; ++c)
+        {
+            if (set.test(c) && (!wantPrintable || (c >= 0x20 && c < 0x7F)) && pick-- == 0)
+                return c;
+        }
+        return -1;
+    }
+
+    const FieldRules &rulesOf(const KeyPlan &plan) const
+    {
+        return plan.merged ? plan.merged->rules : plan.schema->getRules();
+    }
+
+    PatternSet patternsOf(const KeyPlan &plan, uint32_t &budget) const
+    {
+        if (plan.merged)
+            return plan.merged->patterns();
+        budget = FieldSchema::stepBudget(plan.schema->getRules());
+        return {plan.schema->getPatternProgram(), &budget, plan.schema->getRules().has(FieldRules::Pattern) ? 1u : 0u};
+    }
+
+    bool canTarget(const KeyPlan &plan, PayloadCase kind) const
+    {
+        const FieldRules &rules = rulesOf(plan);
+        bool plaintext = !plan.cipher || encryptor_; // Length and pattern cases need to encrypt the result
+        switch (kind)
+        {
+        case PayloadCase::ShortString:
+            return rules.type == FieldType::String && plaintext && rules.has(FieldRules::LengthConstraints) && rules.minLength >= 1;
+        case PayloadCase::LongString:
+            return rules.type == FieldType::String && plaintext && rules.has(FieldRules::LengthConstraints) && rules.maxLength < 65535;
+        case PayloadCase::PatternNearMiss:
+            return rules.type == FieldType::String && plaintext && rules.has(FieldRules::Pattern);
+        case PayloadCase::ValueBelow:
+            return (rules.type == FieldType::Integer || rules.type == FieldType::Float) && rules.has(FieldRules::ValueConstraints) && !rules.has(FieldRules::Clamp) && rules.minValue > -1e9f;
+        case PayloadCase::ValueAbove:
+            return (rules.type == FieldType::Integer || rules.type == FieldType::Float) && rules.has(FieldRules::ValueConstraints) && !rules.has(FieldRules::Clamp) && rules.maxValue < 1e9f;
+        case PayloadCase::WrongType:
+            return rules.type != FieldType::Unknown;
+        case PayloadCase::MissingRequired:
+            return plan.entry->required;
+        case PayloadCase::OversizedArray:
+            return rules.type == FieldType::Array && rules.has(FieldRules::ItemsConstraints) && rules.maxItems < 4096;
+        case PayloadCase::DeepNesting:
+            return true;
+        default:
+            return false;
+        }
+    }
+    //----------------------------------------------
+    bool writeObject(String &out, PayloadCase kind, const KeyPlan *target, size_t padTo)
+    {
+        size_t start = out.length();
+        bool first = true;
+        out += '{';
+        for (const KeyPlan &plan : plans_)
+        {
+            bool targeted = &plan == target;
+            if (targeted && kind == PayloadCase::MissingRequired)
+                continue;
+            String value;
+            if (!writeValue(value, plan, targeted ? kind : (kind == PayloadCase::Boundary ? kind : PayloadCase::Valid)))
+                return false;
+            if (!first)
+                out += ',';
+            first = false;
+            appendString(out, plan.entry->name, plan.entry->length);
+            out += ':';
+            out += value;
+        }
+        if (padTo && !validator_.isStrict() && !validator_.maxKeys())
+        {
+            for (int pad = 0; out.length() - start + 1 < padTo; ++pad)
+            {
+                char key[16];
+                snprintf(key, sizeof(key), "_pad%d", pad);
+                size_t room = padTo - (out.length() - start) - 1;
+                size_t length = room > strlen(key) + 6 ? room - strlen(key) - 6 : 0;
+                if (!first)
+                    out += ',';
+                first = false;
+                appendString(out, key, strlen(key));
+                out += ":\"";
+                for (size_t i = 0; i < length; ++i)
+                    out += (char)('a' + next() % 26);
+                out += '"';
+            }
+        }
+        out += '}';
+        return true;
+    }
+
+    bool writeValue(String &out, const KeyPlan &plan, PayloadCase kind)
+    {
+        const FieldRules &rules = rulesOf(plan);
+        if (kind == PayloadCase::DeepNesting)
+        {
+            for (int i = 0; i < PAYLOAD_GENERATOR_NESTING; ++i)
+                out += '[';
+            for (int i = 0; i < PAYLOAD_GENERATOR_NESTING; ++i)
+                out += ']';
+            return true;
+        }
+        if (kind == PayloadCase::WrongType)
+        {
+            out += rules.type == FieldType::String ? "42" : (rules.type == FieldType::Array ? "{}" : "\"x\"");
+            return true;
+        }
+        switch (rules.type)
+        {
+        case FieldType::Boolean:
+            out += (next() & 1) ? "true" : "false";
+            return true;
+        case FieldType::Integer:
+        {
+            long long low = rules.has(FieldRules::ValueConstraints) ? (long long)ceilf(std::max(rules.minValue, -1e9f)) : -1000;
+            long long high = rules.has(FieldRules::ValueConstraints) ? (long long)floorf(std::min(rules.maxValue, 1e9f)) : 1000;
+            if (high < low)
+                return false;
+            long long value = kind == PayloadCase::ValueBelow   ? low - 1
+                              : kind == PayloadCase::ValueAbove ? high + 1
+                              : kind == PayloadCase::Boundary   ? ((next() & 1) ? low : high)
+                                                                : low + (long long)(next() % (uint32_t)(high - low + 1));
+            char text[24];
+            snprintf(text, sizeof(text), "%lld", value);
+            out += text;
+            return true;
+        }
+        case FieldType::Float:
+        {
+            double low = rules.has(FieldRules::ValueConstraints) ? rules.minValue : -1000.0;
+            double high = rules.has(FieldRules::ValueConstraints) ? rules.maxValue : 1000.0;
+            double step = std::max(1.0, fabs(kind == PayloadCase::ValueBelow ? low : high) * 0.01); // well past float rounding
+            double value = kind == PayloadCase::ValueBelow   ? low - step
+                           : kind == PayloadCase::ValueAbove ? high + step
+                           : kind == PayloadCase::Boundary   ? ((next() & 1) ? low : high)
+                                                             : low + (high - low) * (next() % 10001) / 10000.0;
+            char text[32];
+            snprintf(text, sizeof(text), "%.9g", value);
+            out += text;
+            return true;
+        }
+        case FieldType::Array:
+        {
+            size_t low = rules.has(FieldRules::ItemsConstraints) ? (size_t)std::max(rules.minItems, 0) : 0;
+            size_t high = rules.has(FieldRules::ItemsConstraints) ? (size_t)std::max(rules.maxItems, 0) : 4;
+            size_t count = kind == PayloadCase::OversizedArray ? high + 1
+                           : kind == PayloadCase::Boundary     ? ((next() & 1) ? low : high)
+                                                               : low + next() % (high - low + 1);
+            out += '[';
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (i)
+                    out += ',';
+                out += String((int)(next() % 100));
+            }
+            out += ']';
+            return true;
+        }
+        case FieldType::String:
+        {
+            String text;
+            auto sample = samples_.find(plan.entry->name);
+            if (sample != samples_.end() && (kind == PayloadCase::Valid || kind == PayloadCase::Boundary))
+                text = sample->second; // already in wire form
+            else
+            {
+                if (!writeString(text, plan, rules, kind))
+                    return false;
+                if (plan.cipher)
+                {
+                    if (!encryptor_)
+                        return false;
+                    text = encryptor_(text);
+                }
+            }
+            appendString(out, text.c_str(), text.length());
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    // Plaintext of a string value
+    bool writeString(String &out, const KeyPlan &plan, const FieldRules &rules, PayloadCase kind)
+    {
+        bool bounded = rules.has(FieldRules::LengthConstraints);
+        size_t low = bounded ? (size_t)std::max(rules.minLength, 0) : 0;
+        size_t high = bounded && rules.maxLength < 65535 ? (size_t)std::max(rules.maxLength, 0) : std::max(low, unboundedLength_);
+        if (high < low)
+            return false;
+        size_t length = kind == PayloadCase::ShortString  ? low - 1
+                        : kind == PayloadCase::LongString ? high + 1
+                        : kind == PayloadCase::Boundary   ? ((next() & 1) ? low : high)
+                                                          : low + next() % (high - low + 1);
+
+        uint32_t budget;
+        PatternSet patterns = patternsOf(plan, budget);
+        bool codePoints = rules.has(FieldRules::CodePoints);
+        if (patterns.count == 0 || kind == PayloadCase::ShortString || kind == PayloadCase::LongString)
+        {
+            for (size_t i = 0; i < length; ++i)
+            {
+                if (codePoints && next() % 8 == 0)
+                    out += "\xC3\xA9"; // é: two bytes, one code point
+                else
+                    out += (char)('a' + next() % 26);
+            }
+            return true;
+        }
+
+        // Walk the first pattern, then check the whole rule set
+        ValidationContext ctx;
+        for (int attempt = 0; attempt < PAYLOAD_GENERATOR_ATTEMPTS; ++attempt)
+        {
+            if (!synthesize(patterns.programs[0], length, *this, out))
+                return false;
+            ctx.reset();
+            if (!FieldSchema::checkString(rules, patterns, out.c_str(), out.length(), ctx))
+                continue;
+            return kind != PayloadCase::PatternNearMiss || nearMiss(out, rules, patterns);
+        }
+        return false;
+    }
+
+    // Change one byte so the patterns stop matching, keeping the length
+    bool nearMiss(String &text, const FieldRules &rules, const PatternSet &patterns)
+    {
+        static const char replacements[] = "!Zz0 -._@#";
+        ValidationContext ctx;
+        for (int attempt = 0; attempt < PAYLOAD_GENERATOR_ATTEMPTS && text.length(); ++attempt)
+        {
+            String candidate = text;
+            size_t at = next() % candidate.length();
+            char original = candidate[at];
+            candidate[at] = replacements[next() % (sizeof(replacements) - 1)];
+            if (candidate[at] == original)
+                continue;
+            ctx.reset();
+            if (FieldSchema::checkLength(rules, candidate.length(), ctx) && !FieldSchema::checkPatterns(patterns, candidate.c_str(), candidate.c_str() + candidate.length(), ctx))
+            {
+                text = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void appendString(String &out, const char *text, size_t length)
+    {
+        out += '"';
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint8_t c = text[i];
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += (char)c;
+            }
+            else if (c < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else
+                out += (char)c;
+        }
+        out += '"';
+    }
+
+    // The validator agrees with the label: valid passes, invalid fails on its target key. Only DeepNesting
+    // may stop at the parser; any other body that does not parse is a generator bug, not a rejection.
+    bool labelHolds(const String &body, PayloadCase kind, bool valid, const KeyPlan *target) const
+    {
+        DynamicJsonDocument doc(body.length() * 9 + 1024); // Worst case is one 16-byte slot per two characters
+        if (deserializeJson(doc, body.c_str(), body.length()))
+            return kind == PayloadCase::DeepNesting;
+        ValidationContext ctx;
+        bool result = arrayBody_ ? validator_.isArrayValid(doc.as<JsonVariant>(), ctx) : validator_.isValid(doc.as<JsonVariant>(), ctx);
+        if (result != valid)
+            return false;
+        return valid || target == nullptr || (ctx.failedField && strcmp(ctx.failedField, target->entry->name) == 0);
+    }
+};
+
+#endif // PAT_payloadGenerator_H
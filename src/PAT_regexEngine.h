@@ -0,0 +1,1250 @@
+#ifndef PAT_regexEngine_H
+#define PAT_regexEngine_H
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+//===========================================================================================================================================
+// Budgeted regex engine
+//
+// A small ECMAScript-subset regex engine replacing std::regex for FieldSchema patterns, built so that no
+// input can pin a core or trip the task watchdog:
+//
+//  - setPattern() compiles the pattern once into a flat program of plain-data instructions.
+//  - Patterns without backreferences or lookarounds are classified linear at compile time and run on a
+//    Pike VM (parallel NFA simulation): O(length x program) time, no budget accounting needed.
+//  - All other patterns run on a backtracking VM that counts every instruction against a step budget
+//    (and optionally a time budget) and fails closed when it is exhausted; each such rejection bumps
+//    PatRegex::budgetExhausted().
+//
+// Supported syntax: literals and escapes (\d \D \w \W \s \S \b \B \n \r \t \f \v \0 \xHH, escaped
+// punctuation), '.', '^', '$', classes with ranges and negation, groups (capturing, (?:...)), lookahead
+// (?=...) (?!...), alternation, quantifiers * + ? {n} {n,} {n,m} and their lazy forms, backreferences
+// \1-\9. Matching is regex_search semantics (unanchored unless the pattern says otherwise) on bytes.
+// Deviation from ECMAScript: captures made inside a lookahead are not visible outside it.
+//
+// Programs are position independent (PatRegexView) so they can be emitted as C++ tables or stored in a
+// schema plan and executed in place.
+//-------------------------------------------------------------------
+#ifndef PAT_REGEX_STEP_BUDGET
+#define PAT_REGEX_STEP_BUDGET 50000UL // Backtracking steps per match, ~ a few ms on an ESP32
+#endif
+#ifndef PAT_REGEX_TIME_BUDGET_US
+#define PAT_REGEX_TIME_BUDGET_US 0UL // Optional wall-clock cap per match in microseconds, 0 = off
+#endif
+#ifndef PAT_REGEX_MAX_PROGRAM
+#define PAT_REGEX_MAX_PROGRAM 4096 // Instructions after expanding counted repetitions
+#endif
+#ifndef PAT_REGEX_STACK_PROGRAM
+#define PAT_REGEX_STACK_PROGRAM 128 // Pike VM keeps thread lists on the stack up to this program size
+#endif
+#ifndef PAT_REGEX_MAX_LOOK_DEPTH
+#define PAT_REGEX_MAX_LOOK_DEPTH 4 // Nested lookaheads
+#endif
+#ifndef PAT_REGEX_MAX_LOCKSTEP
+#define PAT_REGEX_MAX_LOCKSTEP 8 // Linear programs searchAll() runs in one pass; more run one by one
+#endif
+#define PAT_REGEX_MAX_GROUPS 9
+
+enum class PatRegexOp : uint8_t
+{
+    Match = 0,
+    Char,     // arg = byte
+    Class,    // x = class index
+    Any,      // any byte except \n and \r
+    Split,    // try x first, then y
+    Jmp,      // x
+    Save,     // x = capture slot
+    Bol,      // start of input
+    Eol,      // end of input
+    Word,     // \b
+    NotWord,  // \B
+    Backref,  // x = group number
+    Look,     // arg = negate, body at pc+1, x = continuation
+    LookEnd,  // end of a lookahead body
+    Mark,     // x = progress slot, remember position
+    Progress, // x = progress slot, fail if no input was consumed since Mark
+};
+
+struct PatRegexInst
+{
+    PatRegexOp op;
+    uint8_t arg;
+    uint16_t x;
+    uint16_t y;
+    uint16_t reserved;
+};
+
+struct PatRegexClass
+{
+    uint32_t bits[8];
+    bool test(uint8_t c) const { return (bits[c >> 5] >> (c & 31)) & 1; }
+};
+
+struct PatRegexView
+{
+    enum Flags : uint16_t
+    {
+        Linear = 1 << 0,   // Pike VM, no budget
+        Anchored = 1 << 1, // starts with ^, only try offset 0
+    };
+
+    const PatRegexInst *insts;
+    uint32_t instCount;
+    const PatRegexClass *classes;
+    uint32_t classCount;
+    uint16_t flags;
+    uint16_t slots; // capture slots (2 per group) + progress slots
+};
+
+enum class PatRegexResult : uint8_t
+{
+    NoMatch = 0,
+    Match,
+    BudgetExhausted,
+};
+//-------------------------------------------------------------------
+class PatRegex
+{
+public:
+    PatRegex() = default;
+    explicit PatRegex(const char *pattern) { compile(pattern); }
+    //----------------------------------------------
+    bool compile(const char *pattern)
+    {
+        insts_.clear();
+        classes_.clear();
+        nodes_.clear();
+        groups_ = 0;
+        progressSlots_ = 0;
+        lookDepth_ = 0;
+        braceError_ = false;
+        hasBackref_ = false;
+        hasLook_ = false;
+        valid_ = false;
+
+        src_ = pattern;
+        pos_ = pattern;
+        int root = parseAlternation();
+        if (root < 0 || *pos_ != '\0')
+            return false;
+        for (int ref : backrefs_)
+        {
+            if (ref > groups_)
+                return false;
+        }
+
+        if (!emit(root))
+            return false;
+        insts_.push_back(inst(PatRegexOp::Match));
+        if (insts_.size() > PAT_REGEX_MAX_PROGRAM)
+            return false;
+
+        // Progress slots sit after the capture slots
+        for (PatRegexInst &i : insts_)
+        {
+            if (i.op == PatRegexOp::Mark || i.op == PatRegexOp::Progress)
+                i.x += 2 * (PAT_REGEX_MAX_GROUPS + 1);
+        }
+        nodes_.clear();
+        backrefs_.clear();
+        valid_ = true;
+        return true;
+    }
+    //----------------------------------------------
+    bool isValid() const { return valid_; }
+    bool isLinear() const { return valid_ && !hasBackref_ && !hasLook_; }
+
+    PatRegexView view() const
+    {
+        PatRegexView v;
+        v.insts = insts_.data();
+        v.instCount = insts_.size();
+        v.classes = classes_.data();
+        v.classCount = classes_.size();
+        v.flags = (isLinear() ? PatRegexView::Linear : 0) | (!insts_.empty() && insts_[0].op == PatRegexOp::Bol ? PatRegexView::Anchored : 0);
+        v.slots = 2 * (PAT_REGEX_MAX_GROUPS + 1) + progressSlots_;
+        return v;
+    }
+    //----------------------------------------------
+    PatRegexResult search(const char *begin, const char *end, uint32_t stepBudget = PAT_REGEX_STEP_BUDGET) const
+    {
+        if (!valid_)
+            return PatRegexResult::NoMatch;
+        return search(view(), begin, end, stepBudget);
+    }
+    //----------------------------------------------
+    static PatRegexResult search(const PatRegexView &program, const char *begin, const char *end, uint32_t stepBudget = PAT_REGEX_STEP_BUDGET)
+    {
+        if (program.flags & PatRegexView::Linear)
+            return pike(program, (const uint8_t *)begin, (const uint8_t *)end) ? PatRegexResult::Match : PatRegexResult::NoMatch;
+
+        Backtracker vm(program, (const uint8_t *)begin, (const uint8_t *)end, stepBudget);
+        PatRegexResult result = vm.search();
+        if (result == PatRegexResult::BudgetExhausted)
+            budgetCounter().fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+    //----------------------------------------------
+    // Match only when every program matches; `budgets` holds the step budget of each program. Linear
+    // programs advance together in one pass over the input, each dropping out as soon as it has matched,
+    // and the pass stops at the first one that can no longer match. Backtracking programs then run one by
+    // one under their own budget.
+    static PatRegexResult searchAll(const PatRegexView *programs, const uint32_t *budgets, size_t count, const char *begin, const char *end)
+    {
+        size_t linear = 0;
+        for (size_t k = 0; k < count; ++k)
+            linear += (programs[k].flags & PatRegexView::Linear) != 0;
+        if (linear > 1 && !lockstep(programs, count, (const uint8_t *)begin, (const uint8_t *)end))
+            return PatRegexResult::NoMatch;
+
+        size_t stepped = 0; // linear programs lockstep() covered
+        for (size_t k = 0; k < count; ++k)
+        {
+            if ((programs[k].flags & PatRegexView::Linear) && linear > 1 && stepped++ < PAT_REGEX_MAX_LOCKSTEP)
+                continue;
+            PatRegexResult result = search(programs[k], begin, end, budgets[k]);
+            if (result != PatRegexResult::Match)
+                return result;
+        }
+        return PatRegexResult::Match;
+    }
+    //----------------------------------------------
+    // Check a program that did not come from compile() (e.g. read from flash) before running it.
+    static bool verify(const PatRegexView &program)
+    {
+        if (program.instCount == 0 || program.instCount > PAT_REGEX_MAX_PROGRAM || program.slots > 2 * (PAT_REGEX_MAX_GROUPS + 1) + PAT_REGEX_MAX_PROGRAM)
+            return false;
+        if (program.insts[program.instCount - 1].op != PatRegexOp::Match)
+            return false;
+        bool linear = true;
+        for (uint32_t pc = 0; pc < program.instCount; ++pc)
+        {
+            const PatRegexInst &i = program.insts[pc];
+            switch (i.op)
+            {
+            case PatRegexOp::Match:
+            case PatRegexOp::Char:
+            case PatRegexOp::Any:
+            case PatRegexOp::Bol:
+            case PatRegexOp::Eol:
+            case PatRegexOp::Word:
+            case PatRegexOp::NotWord:
+            case PatRegexOp::LookEnd:
+                break;
+            case PatRegexOp::Class:
+                if (i.x >= program.classCount)
+                    return false;
+                break;
+            case PatRegexOp::Split:
+                if (i.x >= program.instCount || i.y >= program.instCount)
+                    return false;
+                break;
+            case PatRegexOp::Jmp:
+                if (i.x >= program.instCount)
+                    return false;
+                break;
+            case PatRegexOp::Save:
+            case PatRegexOp::Mark:
+            case PatRegexOp::Progress:
+                if (i.x >= program.slots)
+                    return false;
+                break;
+            case PatRegexOp::Backref:
+                linear = false;
+                if (i.x < 1 || i.x > PAT_REGEX_MAX_GROUPS || 2u * i.x + 1 >= program.slots)
+                    return false; // reads slots 2x and 2x+1
+                break;
+            case PatRegexOp::Look:
+                linear = false;
+                if (i.x >= program.instCount || pc + 1 >= program.instCount)
+                    return false;
+                break;
+            default:
+                return false;
+            }
+        }
+        return linear || !(program.flags & PatRegexView::Linear);
+    }
+    //----------------------------------------------
+    // Matches rejected because the budget ran out, across all patterns since boot
+    static uint32_t budgetExhausted()
+    {
+        return budgetCounter().load(std::memory_order_relaxed);
+    }
+    //----------------------------------------------
+private:
+    //----------------------------------------------
+    // Parse tree
+    struct Node
+    {
+        enum Kind : uint8_t
+        {
+            Empty,
+            Char,
+            Class,
+            Any,
+            Bol,
+            Eol,
+            Word,
+            NotWord,
+            Backref,
+            Group, // value = capture index, 0 for non-capturing
+            Look,  // value = negate
+            Concat,
+            Alternate,
+            Repeat,
+        } kind;
+        int value;
+        int min, max; // Repeat, max < 0 = unbounded
+        bool greedy;
+        std::vector<int> children;
+    };
+
+    std::vector<PatRegexInst> insts_;
+    std::vector<PatRegexClass> classes_;
+    std::vector<Node> nodes_;
+    std::vector<int> backrefs_;
+    const char *src_ = nullptr;
+    const char *pos_ = nullptr;
+    int groups_ = 0;
+    int progressSlots_ = 0;
+    int lookDepth_ = 0;
+    bool braceError_ = false;
+    bool hasBackref_ = false;
+    bool hasLook_ = false;
+    bool valid_ = false;
+
+    static std::atomic<uint32_t> &budgetCounter()
+    {
+        static std::atomic<uint32_t> counter(0);
+        return counter;
+    }
+
+    static PatRegexInst inst(PatRegexOp op, uint8_t arg = 0, uint16_t x = 0, uint16_t y = 0)
+    {
+        PatRegexInst i = {op, arg, x, y, 0};
+        return i;
+    }
+
+    int node(Node::Kind kind, int value = 0)
+    {
+        Node n;
+        n.kind = kind;
+        n.value = value;
+        n.min = n.max = 0;
+        n.greedy = true;
+        nodes_.push_back(n);
+        return nodes_.size() - 1;
+    }
+    //----------------------------------------------
+    // Parser
+    int parseAlternation()
+    {
+        int first = parseConcat();
+        if (first < 0 || *pos_ != '|')
+            return first;
+        int alt = node(Node::Alternate);
+        nodes_[alt].children.push_back(first);
+        while (*pos_ == '|')
+        {
+            ++pos_;
+            int next = parseConcat();
+            if (next < 0)
+                return -1;
+            nodes_[alt].children.push_back(next);
+        }
+        return alt;
+    }
+
+    int parseConcat()
+    {
+        int concat = node(Node::Concat);
+        while (*pos_ != '\0' && *pos_ != '|' && *pos_ != ')')
+        {
+            int atom = parseRepeat();
+            if (atom < 0)
+                return -1;
+            nodes_[concat].children.push_back(atom);
+        }
+        return concat;
+    }
+
+    int parseRepeat()
+    {
+        int atom = parseAtom();
+        if (atom < 0)
+            return -1;
+        for (;;)
+        {
+            int min, max;
+            const char *save = pos_;
+            if (*pos_ == '*')
+                min = 0, max = -1, ++pos_;
+            else if (*pos_ == '+')
+                min = 1, max = -1, ++pos_;
+            else if (*pos_ == '?')
+                min = 0, max = 1, ++pos_;
+            else if (*pos_ == '{' && parseBraces(min, max))
+                ;
+            else if (*pos_ == '{' && braceError_)
+                return -1;
+            else
+                return atom;
+
+            Node::Kind kind = nodes_[atom].kind;
+            if (kind == Node::Bol || kind == Node::Eol || kind == Node::Word || kind == Node::NotWord || kind == Node::Look)
+            {
+                pos_ = save;
+                return -1; // nothing to repeat
+            }
+            int rep = node(Node::Repeat);
+            nodes_[rep].min = min;
+            nodes_[rep].max = max;
+            nodes_[rep].greedy = true;
+            if (*pos_ == '?')
+            {
+                nodes_[rep].greedy = false;
+                ++pos_;
+            }
+            nodes_[rep].children.push_back(atom);
+            atom = rep;
+        }
+    }
+
+    // {n} {n,} {n,m}; anything else leaves '{' to be read as a literal
+    bool parseBraces(int &min, int &max)
+    {
+        const char *p = pos_ + 1;
+        if (!isdigit((unsigned char)*p))
+            return false;
+        min = 0;
+        while (isdigit((unsigned char)*p))
+        {
+            min = min * 10 + (*p++ - '0');
+            if (min > PAT_REGEX_MAX_PROGRAM)
+                return false;
+        }
+        max = min;
+        if (*p == ',')
+        {
+            ++p;
+            if (*p == '}')
+                max = -1;
+            else
+            {
+                if (!isdigit((unsigned char)*p))
+                    return false;
+                max = 0;
+                while (isdigit((unsigned char)*p))
+                {
+                    max = max * 10 + (*p++ - '0');
+                    if (max > PAT_REGEX_MAX_PROGRAM)
+                        return false;
+                }
+                if (max < min)
+                {
+                    braceError_ = true; // well formed but out of order
+                    return false;
+                }
+            }
+        }
+        if (*p != '}')
+            return false;
+        pos_ = p + 1;
+        return true;
+    }
+
+    int parseAtom()
+    {
+        char c = *pos_++;
+        switch (c)
+        {
+        case '(':
+        {
+            int group;
+            if (pos_[0] == '?' && pos_[1] == ':')
+            {
+                pos_ += 2;
+                group = node(Node::Group, 0);
+            }
+            else if (pos_[0] == '?' && (pos_[1] == '=' || pos_[1] == '!'))
+            {
+                group = node(Node::Look, pos_[1] == '!');
+                hasLook_ = true;
+                pos_ += 2;
+            }
+            else if (pos_[0] == '?')
+                return -1; // lookbehind and named groups are not supported
+            else
+            {
+                if (groups_ == PAT_REGEX_MAX_GROUPS)
+                    return -1;
+                group = node(Node::Group, ++groups_);
+            }
+            bool look = nodes_[group].kind == Node::Look;
+            if (look && ++lookDepth_ > PAT_REGEX_MAX_LOOK_DEPTH)
+                return -1;
+            int body = parseAlternation();
+            if (body < 0 || *pos_ != ')')
+                return -1;
+            ++pos_;
+            if (look)
+                --lookDepth_;
+            nodes_[group].children.push_back(body);
+            return group;
+        }
+        case '[':
+            return parseClass();
+        case '.':
+            return node(Node::Any);
+        case '^':
+            return node(Node::Bol);
+        case '$':
+            return node(Node::Eol);
+        case '\\':
+            return parseEscape();
+        case '*':
+        case '+':
+        case '?':
+        case ')':
+        case '\0':
+            return -1;
+        default:
+            return node(Node::Char, (uint8_t)c);
+        }
+    }
+
+    int parseEscape()
+    {
+        char c = *pos_++;
+        PatRegexClass cls;
+        if (shorthandClass(c, cls))
+            return addClass(cls);
+        switch (c)
+        {
+        case 'b':
+            return node(Node::Word);
+        case 'B':
+            return node(Node::NotWord);
+        case '\0':
+            return -1;
+        default:
+            break;
+        }
+        if (c >= '1' && c <= '9')
+        {
+            hasBackref_ = true;
+            backrefs_.push_back(c - '0');
+            return node(Node::Backref, c - '0');
+        }
+        int value = escapedChar(c);
+        return value < 0 ? -1 : node(Node::Char, value);
+    }
+
+    // \n \t ... and escaped punctuation; -1 for escapes with a meaning we do not support
+    int escapedChar(char c)
+    {
+        switch (c)
+        {
+        case 'n':
+            return '\n';
+        case 'r':
+            return '\r';
+        case 't':
+            return '\t';
+        case 'f':
+            return '\f';
+        case 'v':
+            return '\v';
+        case '0':
+            return '\0';
+        case 'x':
+        {
+            int hi = hexDigit(pos_[0]), lo = hi < 0 ? -1 : hexDigit(pos_[1]);
+            if (lo < 0)
+                return -1;
+            pos_ += 2;
+            return hi * 16 + lo;
+        }
+        default:
+            return isalnum((unsigned char)c) ? -1 : (uint8_t)c;
+        }
+    }
+
+    static int hexDigit(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    static void setRange(PatRegexClass &cls, int from, int to)
+    {
+        for (int c = from; c <= to; ++c)
+            cls.bits[c >> 5] |= 1UL << (c & 31);
+    }
+
+    static void invert(PatRegexClass &cls)
+    {
+        for (uint32_t &word : cls.bits)
+            word = ~word;
+    }
+
+    static bool shorthandClass(char c, PatRegexClass &cls)
+    {
+        memset(&cls, 0, sizeof(cls));
+        switch (c)
+        {
+        case 'd':
+        case 'D':
+            setRange(cls, '0', '9');
+            break;
+        case 'w':
+        case 'W':
+            setRange(cls, '0', '9');
+            setRange(cls, 'A', 'Z');
+            setRange(cls, 'a', 'z');
+            setRange(cls, '_', '_');
+            break;
+        case 's':
+        case 'S':
+            setRange(cls, '\t', '\r'); // \t \n \v \f \r
+            setRange(cls, ' ', ' ');
+            break;
+        default:
+            return false;
+        }
+        if (isupper((unsigned char)c))
+            invert(cls);
+        return true;
+    }
+
+    int addClass(const PatRegexClass &cls)
+    {
+        classes_.push_back(cls);
+        return node(Node::Class, classes_.size() - 1);
+    }
+
+    int parseClass()
+    {
+        PatRegexClass cls;
+        memset(&cls, 0, sizeof(cls));
+        bool negate = false;
+        if (*pos_ == '^')
+        {
+            negate = true;
+            ++pos_;
+        }
+        while (*pos_ != ']')
+        {
+            int from;
+            if (*pos_ == '\0')
+                return -1;
+            if (*pos_ == '\\')
+            {
+                if (*++pos_ == '\0')
+                    return -1;
+                PatRegexClass shorthand;
+                if (shorthandClass(*pos_, shorthand))
+                {
+                    ++pos_;
+                    for (int w = 0; w < 8; ++w)
+                        cls.bits[w] |= shorthand.bits[w];
+                    continue;
+                }
+                char e = *pos_++;
+                from = e == 'b' ? '\b' : escapedChar(e);
+                if (from < 0)
+                    return -1;
+            }
+            else
+                from = (uint8_t)*pos_++;
+
+            if (pos_[0] == '-' && pos_[1] != ']' && pos_[1] != '\0')
+            {
+                ++pos_;
+                int to;
+                if (*pos_ == '\\')
+                {
+                    if (*++pos_ == '\0')
+                        return -1;
+                    char e = *pos_++;
+                    PatRegexClass shorthand;
+                    if (shorthandClass(e, shorthand))
+                        return -1; // [a-\d] is not a range
+                    to = e == 'b' ? '\b' : escapedChar(e);
+                    if (to < 0)
+                        return -1;
+                }
+                else
+                    to = (uint8_t)*pos_++;
+                if (to < from)
+                    return -1;
+                setRange(cls, from, to);
+            }
+            else
+                setRange(cls, from, from);
+        }
+        ++pos_;
+        if (negate)
+            invert(cls);
+        return addClass(cls);
+    }
+    //----------------------------------------------
+    // Code generation
+    bool nullable(int n) const
+    {
+        const Node &node = nodes_[n];
+        switch (node.kind)
+        {
+        case Node::Char:
+        case Node::Class:
+        case Node::Any:
+            return false;
+        case Node::Concat:
+            for (int child : node.children)
+            {
+                if (!nullable(child))
+                    return false;
+            }
+            return true;
+        case Node::Alternate:
+            for (int child : node.children)
+            {
+                if (nullable(child))
+                    return true;
+            }
+            return false;
+        case Node::Group:
+            return nullable(node.children[0]);
+        case Node::Repeat:
+            return node.min == 0 || nullable(node.children[0]);
+        default:
+            return true; // assertions, backreferences (may be empty), empty
+        }
+    }
+
+    bool emit(int n)
+    {
+        if (insts_.size() > PAT_REGEX_MAX_PROGRAM)
+            return false;
+        const Node node = nodes_[n];
+        switch (node.kind)
+        {
+        case Node::Empty:
+            return true;
+        case Node::Char:
+            insts_.push_back(inst(PatRegexOp::Char, node.value));
+            return true;
+        case Node::Class:
+            insts_.push_back(inst(PatRegexOp::Class, 0, node.value));
+            return true;
+        case Node::Any:
+            insts_.push_back(inst(PatRegexOp::Any));
+            return true;
+        case Node::Bol:
+            insts_.push_back(inst(PatRegexOp::Bol));
+            return true;
+        case Node::Eol:
+            insts_.push_back(inst(PatRegexOp::Eol));
+            return true;
+        case Node::Word:
+            insts_.push_back(inst(PatRegexOp::Word));
+            return true;
+        case Node::NotWord:
+            insts_.push_back(inst(PatRegexOp::NotWord));
+            return true;
+        case Node::Backref:
+            insts_.push_back(inst(PatRegexOp::Backref, 0, node.value));
+            return true;
+        case Node::Concat:
+            for (int child : node.children)
+            {
+                if (!emit(child))
+                    return false;
+            }
+            return true;
+        case Node::Group:
+            if (node.value == 0)
+                return emit(node.children[0]);
+            insts_.push_back(inst(PatRegexOp::Save, 0, 2 * node.value));
+            if (!emit(node.children[0]))
+                return false;
+            insts_.push_back(inst(PatRegexOp::Save, 0, 2 * node.value + 1));
+            return true;
+        case Node::Look:
+        {
+            size_t look = insts_.size();
+            insts_.push_back(inst(PatRegexOp::Look, node.value));
+            if (!emit(node.children[0]))
+                return false;
+            insts_.push_back(inst(PatRegexOp::LookEnd));
+            insts_[look].x = insts_.size();
+            return true;
+        }
+        case Node::Alternate:
+        {
+            // split L1, next; L1: a; jmp end; next: split L2, next2; ...
+            std::vector<size_t> jumps;
+            for (size_t i = 0; i < node.children.size(); ++i)
+            {
+                size_t split = 0;
+                bool last = i + 1 == node.children.size();
+                if (!last)
+                {
+                    split = insts_.size();
+                    insts_.push_back(inst(PatRegexOp::Split, 0, split + 1));
+                }
+                if (!emit(node.children[i]))
+                    return false;
+                if (!last)
+                {
+                    jumps.push_back(insts_.size());
+                    insts_.push_back(inst(PatRegexOp::Jmp));
+                    insts_[split].y = insts_.size();
+                }
+            }
+            for (size_t jump : jumps)
+                insts_[jump].x = insts_.size();
+            return true;
+        }
+        case Node::Repeat:
+            return emitRepeat(node);
+        }
+        return false;
+    }
+
+    void emitSplit(size_t at, size_t body, size_t skip, bool greedy)
+    {
+        insts_[at].x = greedy ? body : skip;
+        insts_[at].y = greedy ? skip : body;
+    }
+
+    bool emitRepeat(const Node &node)
+    {
+        int body = node.children[0];
+        for (int i = 0; i < node.min; ++i)
+        {
+            if (!emit(body))
+                return false;
+        }
+        if (node.max < 0)
+        {
+            // loop: split body, out; body; jmp loop  (with an empty-iteration guard for nullable bodies)
+            bool guard = nullable(body);
+            int slot = guard ? progressSlots_++ : 0;
+            size_t loop = insts_.size();
+            insts_.push_back(inst(PatRegexOp::Split));
+            if (guard)
+                insts_.push_back(inst(PatRegexOp::Mark, 0, slot));
+            if (!emit(body))
+                return false;
+            if (guard)
+                insts_.push_back(inst(PatRegexOp::Progress, 0, slot));
+            insts_.push_back(inst(PatRegexOp::Jmp, 0, loop));
+            emitSplit(loop, loop + 1, insts_.size(), node.greedy);
+            return true;
+        }
+        // optional copies: split body, end; body; split body, end; body ...
+        std::vector<size_t> splits;
+        for (int i = node.min; i < node.max; ++i)
+        {
+            splits.push_back(insts_.size());
+            insts_.push_back(inst(PatRegexOp::Split));
+            if (!emit(body))
+                return false;
+        }
+        for (size_t split : splits)
+            emitSplit(split, split + 1, insts_.size(), node.greedy);
+        return true;
+    }
+    //----------------------------------------------
+    // Execution helpers
+    static bool isWordChar(uint8_t c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+    }
+
+    static bool atWordBoundary(const uint8_t *begin, const uint8_t *end, const uint8_t *p)
+    {
+        bool before = p > begin && isWordChar(p[-1]);
+        bool after = p < end && isWordChar(*p);
+        return before != after;
+    }
+
+    static bool assertionHolds(PatRegexOp op, const uint8_t *begin, const uint8_t *end, const uint8_t *p)
+    {
+        switch (op)
+        {
+        case PatRegexOp::Bol:
+            return p == begin;
+        case PatRegexOp::Eol:
+            return p == end;
+        case PatRegexOp::Word:
+            return atWordBoundary(begin, end, p);
+        default:
+            return !atWordBoundary(begin, end, p);
+        }
+    }
+
+    static bool consumes(const PatRegexView &program, const PatRegexInst &i, const uint8_t *p, const uint8_t *end)
+    {
+        if (p >= end)
+            return false;
+        switch (i.op)
+        {
+        case PatRegexOp::Char:
+            return *p == i.arg;
+        case PatRegexOp::Class:
+            return program.classes[i.x].test(*p);
+        default: // Any
+            return *p != '\n' && *p != '\r';
+        }
+    }
+    //----------------------------------------------
+    // Pike VM: set-of-states simulation, every state visited at most once per input position
+    struct ThreadList
+    {
+        uint16_t *dense;
+        uint16_t *sparse;
+        uint32_t size;
+
+        bool contains(uint16_t pc) const { return sparse[pc] < size && dense[sparse[pc]] == pc; }
+        void add(uint16_t pc)
+        {
+            sparse[pc] = size;
+            dense[size++] = pc;
+        }
+    };
+
+    // Follows Jmp/Split/Save/assertions; returns true once Match is reachable
+    static bool addThread(const PatRegexView &program, ThreadList &list, uint16_t *stack, uint16_t start,
+                          const uint8_t *begin, const uint8_t *end, const uint8_t *p)
+    {
+        uint32_t top = 0;
+        stack[top++] = start;
+        while (top)
+        {
+            uint16_t pc = stack[--top];
+            if (list.contains(pc))
+                continue;
+            list.add(pc);
+            const PatRegexInst &i = program.insts[pc];
+            switch (i.op)
+            {
+            case PatRegexOp::Match:
+                return true;
+            case PatRegexOp::Jmp:
+                stack[top++] = i.x;
+                break;
+            case PatRegexOp::Split:
+                stack[top++] = i.y;
+                stack[top++] = i.x;
+                break;
+            case PatRegexOp::Save:
+            case PatRegexOp::Mark:
+            case PatRegexOp::Progress:
+                stack[top++] = pc + 1;
+                break;
+            case PatRegexOp::Bol:
+            case PatRegexOp::Eol:
+            case PatRegexOp::Word:
+            case PatRegexOp::NotWord:
+                if (assertionHolds(i.op, begin, end, p))
+                    stack[top++] = pc + 1;
+                break;
+            default:
+                break; // consuming instruction, stepped in the main loop
+            }
+        }
+        return false;
+    }
+
+    // One program's simulation state. Two sparse sets plus the closure stack; every pc joins a list at
+    // most once and grows the stack by at most one entry, so n + 1 stack slots are enough.
+    struct PikeRun
+    {
+        const PatRegexView *program;
+        ThreadList current;
+        ThreadList next;
+        uint16_t *stack;
+
+        static size_t scratch(const PatRegexView &program) { return program.instCount * 5 + 1; }
+
+        void init(const PatRegexView &p, uint16_t *memory)
+        {
+            uint32_t n = p.instCount;
+            program = &p;
+            current = {memory, memory + n, 0};
+            next = {memory + 2 * n, memory + 3 * n, 0};
+            stack = memory + 4 * n;
+            memset(memory, 0, 4 * n * sizeof(uint16_t));
+        }
+
+        // Consume the byte at p (none at end): 1 matched, -1 can no longer match, 0 undecided
+        int advance(const uint8_t *begin, const uint8_t *end, const uint8_t *p)
+        {
+            bool anchored = program->flags & PatRegexView::Anchored;
+            if ((p == begin || !anchored) && addThread(*program, current, stack, 0, begin, end, p))
+                return 1;
+            if (current.size == 0 && anchored)
+                return -1;
+
+            next.size = 0;
+            for (uint32_t t = 0; t < current.size; ++t)
+            {
+                const PatRegexInst &i = program->insts[current.dense[t]];
+                if ((i.op == PatRegexOp::Char || i.op == PatRegexOp::Class || i.op == PatRegexOp::Any) && consumes(*program, i, p, end))
+                {
+                    if (addThread(*program, next, stack, current.dense[t] + 1, begin, end, p + 1))
+                        return 1;
+                }
+            }
+            if (p == end)
+                return -1;
+            ThreadList swap = current;
+            current = next;
+            next = swap;
+            return 0;
+        }
+    };
+
+    static bool pike(const PatRegexView &program, const uint8_t *begin, const uint8_t *end)
+    {
+        uint16_t local[PAT_REGEX_STACK_PROGRAM * 5 + 1];
+        std::vector<uint16_t> heap;
+        uint16_t *memory = local;
+        if (program.instCount > PAT_REGEX_STACK_PROGRAM)
+        {
+            heap.resize(PikeRun::scratch(program));
+            memory = heap.data();
+        }
+        PikeRun run;
+        run.init(program, memory);
+        for (const uint8_t *p = begin;; ++p)
+        {
+            int state = run.advance(begin, end, p);
+            if (state != 0)
+                return state > 0;
+        }
+    }
+
+    // The first PAT_REGEX_MAX_LOCKSTEP linear programs, stepped together byte by byte
+    static bool lockstep(const PatRegexView *programs, size_t count, const uint8_t *begin, const uint8_t *end)
+    {
+        size_t needed = 0, active = 0;
+        for (size_t k = 0; k < count && active < PAT_REGEX_MAX_LOCKSTEP; ++k)
+        {
+            if (programs[k].flags & PatRegexView::Linear)
+            {
+                needed += PikeRun::scratch(programs[k]);
+                ++active;
+            }
+        }
+        uint16_t local[PAT_REGEX_STACK_PROGRAM * 5 + 1];
+        std::vector<uint16_t> heap;
+        uint16_t *memory = local;
+        if (needed > sizeof(local) / sizeof(local[0]))
+        {
+            heap.resize(needed);
+            memory = heap.data();
+        }
+
+        PikeRun runs[PAT_REGEX_MAX_LOCKSTEP];
+        active = 0;
+        for (size_t k = 0; k < count && active < PAT_REGEX_MAX_LOCKSTEP; ++k)
+        {
+            if (programs[k].flags & PatRegexView::Linear)
+            {
+                runs[active++].init(programs[k], memory);
+                memory += PikeRun::scratch(programs[k]);
+            }
+        }
+
+        for (const uint8_t *p = begin; active; ++p)
+        {
+            for (size_t r = 0; r < active;)
+            {
+                int state = runs[r].advance(begin, end, p);
+                if (state < 0)
+                    return false;
+                if (state > 0)
+                    runs[r] = runs[--active]; // matched, stop stepping it
+                else
+                    ++r;
+            }
+        }
+        return true; // at the end every run has decided, so the loop always exits here
+    }
+    //----------------------------------------------
+    // Backtracking VM with an explicit choice stack and a step budget
+    class Backtracker
+    {
+    public:
+        Backtracker(const PatRegexView &program, const uint8_t *begin, const uint8_t *end, uint32_t budget)
+            : program_(program), begin_(begin), end_(end), budget_(budget), steps_(0), started_(micros())
+        {
+        }
+
+        PatRegexResult search()
+        {
+            std::vector<int32_t> slots(program_.slots, -1);
+            stack_.reserve(32);
+            bool anchored = program_.flags & PatRegexView::Anchored;
+            for (const uint8_t *start = begin_; start <= end_; ++start)
+            {
+                PatRegexResult result = run(0, start, slots.data(), 0);
+                if (result != PatRegexResult::NoMatch || anchored)
+                    return result;
+            }
+            return PatRegexResult::NoMatch;
+        }
+
+    private:
+        struct Frame
+        {
+            uint16_t pc;   // choice: resume here; restore: slot index
+            bool restore;  // restore slot to `value` instead of resuming
+            int32_t value; // choice: input offset; restore: previous slot value
+        };
+
+        const PatRegexView &program_;
+        const uint8_t *begin_;
+        const uint8_t *end_;
+        uint32_t budget_;
+        uint32_t steps_;
+        unsigned long started_;
+        std::vector<Frame> stack_; // shared by nested lookahead runs, each above its own base
+
+        bool overBudget()
+        {
+            if (++steps_ > budget_)
+                return true;
+#if PAT_REGEX_TIME_BUDGET_US > 0
+            if ((steps_ & 1023) == 0 && micros() - started_ > PAT_REGEX_TIME_BUDGET_US)
+                return true;
+#endif
+            return false;
+        }
+
+        // Drops choices above `base`, undoing slot writes; a finished run leaves slots as it found them
+        void unwind(size_t base, int32_t *slots)
+        {
+            while (stack_.size() > base)
+            {
+                if (stack_.back().restore)
+                    slots[stack_.back().pc] = stack_.back().value;
+                stack_.pop_back();
+            }
+        }
+
+        // Runs from `pc` until Match (or LookEnd for a lookahead body)
+        PatRegexResult run(uint16_t pc, const uint8_t *p, int32_t *slots, int depth)
+        {
+            size_t base = stack_.size();
+            for (;;)
+            {
+                if (overBudget())
+                {
+                    unwind(base, slots);
+                    return PatRegexResult::BudgetExhausted;
+                }
+
+                const PatRegexInst &i = program_.insts[pc];
+                bool ok = true;
+                switch (i.op)
+                {
+                case PatRegexOp::Match:
+                case PatRegexOp::LookEnd:
+                    unwind(base, slots);
+                    return PatRegexResult::Match;
+                case PatRegexOp::Char:
+                case PatRegexOp::Class:
+                case PatRegexOp::Any:
+                    ok = consumes(program_, i, p, end_);
+                    if (ok)
+                        ++p, ++pc;
+                    break;
+                case PatRegexOp::Split:
+                    stack_.push_back(Frame{i.y, false, (int32_t)(p - begin_)});
+                    pc = i.x;
+                    break;
+                case PatRegexOp::Jmp:
+                    pc = i.x;
+                    break;
+                case PatRegexOp::Save:
+                case PatRegexOp::Mark:
+                    stack_.push_back(Frame{i.x, true, slots[i.x]});
+                    slots[i.x] = p - begin_;
+                    ++pc;
+                    break;
+                case PatRegexOp::Progress:
+                    ok = slots[i.x] != (int32_t)(p - begin_);
+                    ++pc;
+                    break;
+                case PatRegexOp::Bol:
+                case PatRegexOp::Eol:
+                case PatRegexOp::Word:
+                case PatRegexOp::NotWord:
+                    ok = assertionHolds(i.op, begin_, end_, p);
+                    ++pc;
+                    break;
+                case PatRegexOp::Backref:
+                {
+                    int32_t from = slots[2 * i.x], to = slots[2 * i.x + 1];
+                    if (from >= 0 && to >= from)
+                    {
+                        size_t length = to - from;
+                        ok = (size_t)(end_ - p) >= length && memcmp(begin_ + from, p, length) == 0;
+                        if (ok)
+                            p += length;
+                    }
+                    ++pc;
+                    break;
+                }
+                case PatRegexOp::Look:
+                {
+                    // Atomic: the body's choices are discarded once it has matched or failed
+                    PatRegexResult result = depth < PAT_REGEX_MAX_LOOK_DEPTH ? run(pc + 1, p, slots, depth + 1) : PatRegexResult::BudgetExhausted;
+                    if (result == PatRegexResult::BudgetExhausted)
+                    {
+                        unwind(base, slots);
+                        return result;
+                    }
+                    ok = (result == PatRegexResult::Match) != (i.arg != 0);
+                    pc = i.x;
+                    break;
+                }
+                default:
+                    ok = false;
+                    break;
+                }
+
+                while (!ok)
+                {
+                    if (stack_.size() == base)
+                        return PatRegexResult::NoMatch;
+                    Frame frame = stack_.back();
+                    stack_.pop_back();
+                    if (frame.restore)
+                        slots[frame.pc] = frame.value;
+                    else
+                    {
+                        pc = frame.pc;
+                        p = begin_ + frame.value;
+                        ok = true;
+                    }
+                }
+            }
+        }
+    };
+};
+
+#endif // PAT_regexEngine_H
@@ -0,0 +1,467 @@
+#ifndef PAT_schemaCodegen_H
+#define PAT_schemaCodegen_H
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <vector>
+#include "PAT_dataValidator.h"
+
+//===========================================================================================================================================
+// Schema-to-C++ code generator
+//
+// Turns a Validator into a standalone, straight-line C++ function for hot endpoints: field names, types
+// and limits become constants, the interpretive loop over fields_ disappears and patterns are emitted as
+// precompiled PatRegex program tables in flash. The generated header depends only on ArduinoJson and
+// PAT_regexEngine.h.
+//
+//   String code = SchemaCodegen::emit(wifiValidator, "validateWifiConfig");
+//   String test = SchemaCodegen::emitSelfTest(wifiValidator, "validateWifiConfig");
+//
+// emitSelfTest() produces `bool validateWifiConfig_selftest(const Validator &reference, DeserializationError
+// *parseError = nullptr)`, which replays a table of probe documents through both the generated function
+// and the interpreted Validator and returns false on the first disagreement. A probe that does not parse
+// also returns false and sets *parseError, so it is not mistaken for a code mismatch. The probes start from a base document built from values the
+// schema accepts, then mutate one key at a time (missing, wrong type, each side of every bound).
+//
+// tools/schemaCodegen.cpp wraps this for the Linux host, reading a JSON schema file (see SchemaLoader).
+//-------------------------------------------------------------------
+class SchemaCodegen
+{
+public:
+    //----------------------------------------------
+    // Why emit() would refuse the validator, nullptr if it can be generated. Cross-field rules, strict mode,
+    // key limits, defaults, normalisation and encrypted fields stay with the interpreted Validator.
+    static const char *unsupportedReason(const Validator &validator, const String &functionName)
+    {
+        if (!isIdentifier(functionName))
+            return "function name must be a C++ identifier";
+        if (validator.hasCrossFieldRules())
+            return "cross-field rules are not supported";
+        if (validator.isStrict() || validator.maxKeys())
+            return "strict mode and key limits are not supported";
+        for (const auto &field : validator.fields())
+        {
+            for (const FieldSchema &schema : field.second)
+            {
+                if (schema.hasPatternError())
+                    return "a pattern does not compile";
+                if (schema.hasDefault())
+                    return "defaults are not supported";
+                if (schema.getRules().transforms)
+                    return "normalisation (trim, case, clamp) is not supported";
+                if (schema.getCipher())
+                    return "encrypted fields are not supported";
+            }
+        }
+        return nullptr;
+    }
+
+    // Returns an empty String if the validator cannot be generated (see unsupportedReason()).
+    static String emit(const Validator &validator, const String &functionName)
+    {
+        if (unsupportedReason(validator, functionName))
+            return String();
+
+        String out;
+        out += "// Generated by SchemaCodegen. Do not edit; regenerate from the schema instead.\n";
+        out += "#pragma once\n#include <ArduinoJson.h>\n#include <cstring>\n#include \"PAT_regexEngine.h\"\n#include \"PAT_utf8.h\"\n\n";
+
+        // Patterns first, as compiled program tables
+        int patternIndex = 0;
+        for (const auto &field : validator.fields())
+        {
+            for (const FieldSchema &schema : field.second)
+            {
+                if (schema.getRules().has(FieldRules::Pattern))
+                    emitProgram(out, functionName + "_pattern" + String(patternIndex++), schema.getPattern(), schema.getCompiledPattern()->view());
+            }
+        }
+
+        out += "inline bool " + functionName + "(const JsonVariant &json)\n{\n";
+        patternIndex = 0;
+        for (const auto &field : validator.fields())
+        {
+            const String &name = field.first;
+            bool required = false;
+            if (name.isEmpty())
+            {
+                out += "\n    // whole document\n    {\n        JsonVariant value = json;\n";
+            }
+            else
+            {
+                out += "\n    // " + quote(name) + "\n";
+                out += "    if (json.containsKey(" + quote(name) + "))\n    {\n        JsonVariant value = json[" + quote(name) + "];\n";
+            }
+            for (const FieldSchema &schema : field.second)
+            {
+                emitChecks(out, functionName, schema.getRules(), patternIndex);
+                required |= schema.isRequired();
+            }
+            out += "    }\n";
+            if (required && !name.isEmpty())
+                out += "    else\n        return false; // required\n";
+        }
+        out += "    return true;\n}\n";
+        return out;
+    }
+    //----------------------------------------------
+    static String emitSelfTest(const Validator &validator, const String &functionName)
+    {
+        if (!isIdentifier(functionName))
+            return String();
+
+        std::vector<String> probes;
+        buildProbes(validator, probes);
+
+        String out;
+        out += "// Generated by SchemaCodegen. Checks " + functionName + "() against the interpreted Validator.\n";
+        out += "#pragma once\n#include <ArduinoJson.h>\n#include \"PAT_dataValidator.h\"\n\n";
+        out += "inline bool " + functionName + "_selftest(const Validator &reference, DeserializationError *parseError = nullptr)\n{\n";
+        out += "    static const char *const probes[] = {\n";
+        for (const String &probe : probes)
+            out += "        " + quote(probe) + ",\n";
+        out += "    };\n";
+        // Every value or member takes a slot and needs at least two characters of text ("1,"), and the
+        // copied strings never exceed the text itself
+        size_t length = maxLength(probes);
+        out += "    DynamicJsonDocument doc(JSON_OBJECT_SIZE(" + String((int)(length / 2 + 1)) + ") + " + String((int)(length + 1)) + ");\n";
+        out += "    for (const char *probe : probes)\n    {\n";
+        out += "        DeserializationError error = deserializeJson(doc, probe);\n";
+        out += "        if (error)\n        {\n            if (parseError)\n                *parseError = error;\n            return false;\n        }\n";
+        out += "        if (" + functionName + "(doc.as<JsonVariant>()) != reference.isValid(doc.as<JsonVariant>()))\n            return false;\n";
+        out += "    }\n    return true;\n}\n";
+        return out;
+    }
+    //----------------------------------------------
+    // C++ string literal, octal escapes so a following digit is never swallowed
+    static String quote(const String &text)
+    {
+        String out = "\"";
+        for (unsigned i = 0; i < text.length(); ++i)
+        {
+            unsigned char c = text[i];
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += (char)c;
+            }
+            else if (c >= 0x20 && c < 0x7f && c != '?') // '?' avoids trigraphs
+                out += (char)c;
+            else
+            {
+                char escaped[5];
+                snprintf(escaped, sizeof(escaped), "\\%03o", c);
+                out += escaped;
+            }
+        }
+        return out + "\"";
+    }
+    //----------------------------------------------
+private:
+    static bool isIdentifier(const String &name)
+    {
+        if (name.isEmpty() || isdigit((unsigned char)name[0]))
+            return false;
+        for (unsigned i = 0; i < name.length(); ++i)
+        {
+            if (!isalnum((unsigned char)name[i]) && name[i] != '_')
+                return false;
+        }
+        return true;
+    }
+
+    // Float literal that round-trips exactly and compares the same way FieldSchema does
+    static String floatLiteral(float value)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.9g", value);
+        String out = buffer;
+        if (out.indexOf('.') < 0 && out.indexOf('e') < 0 && out.indexOf('n') < 0)
+            out += ".0";
+        return out + "f";
+    }
+
+    static const char *opName(PatRegexOp op)
+    {
+        static const char *const names[] = {"Match", "Char", "Class", "Any", "Split", "Jmp", "Save", "Bol",
+                                            "Eol", "Word", "NotWord", "Backref", "Look", "LookEnd", "Mark", "Progress"};
+        return names[(uint8_t)op];
+    }
+
+    static String hex32(uint32_t value)
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "0x%08lXUL", (unsigned long)value);
+        return buffer;
+    }
+
+    static void emitProgram(String &out, const String &name, const String &source, const PatRegexView &program)
+    {
+        out += "// " + quote(source) + "\n";
+        out += "static const PatRegexInst " + name + "_insts[] = {\n";
+        for (uint32_t pc = 0; pc < program.instCount; ++pc)
+        {
+            const PatRegexInst &i = program.insts[pc];
+            out += "    {PatRegexOp::" + String(opName(i.op)) + ", " + String(i.arg) + ", " + String(i.x) + ", " + String(i.y) + ", 0},\n";
+        }
+        out += "};\n";
+        String classes = "nullptr";
+        if (program.classCount)
+        {
+            classes = name + "_classes";
+            out += "static const PatRegexClass " + classes + "[] = {\n";
+            for (uint32_t c = 0; c < program.classCount; ++c)
+            {
+                out += "    {{";
+                for (int w = 0; w < 8; ++w)
+                    out += (w ? ", " : "") + hex32(program.classes[c].bits[w]);
+                out += "}},\n";
+            }
+            out += "};\n";
+        }
+        out += "static const PatRegexView " + name + " = {" + name + "_insts, " + String(program.instCount) + ", " + classes + ", " +
+               String(program.classCount) + ", " + String(program.flags) + ", " + String(program.slots) + "};\n\n";
+    }
+
+    static void emitChecks(String &out, const String &functionName, const FieldRules &rules, int &patternIndex)
+    {
+        switch (rules.type)
+        {
+        case FieldType::Boolean:
+            out += "        if (!value.is<bool>())\n            return false;\n";
+            break;
+        case FieldType::Integer:
+            out += "        if (!value.is<int>())\n            return false;\n";
+            if (rules.has(FieldRules::ValueConstraints))
+                out += "        if (value.as<int>() < " + floatLiteral(rules.minValue) + " || value.as<int>() > " + floatLiteral(rules.maxValue) + ")\n            return false;\n";
+            break;
+        case FieldType::Float:
+            out += "        if (!value.is<float>())\n            return false;\n";
+            if (rules.has(FieldRules::ValueConstraints))
+                out += "        if (value.as<float>() < " + floatLiteral(rules.minValue) + " || value.as<float>() > " + floatLiteral(rules.maxValue) + ")\n            return false;\n";
+            break;
+        case FieldType::String:
+            out += "        if (!value.is<const char *>())\n            return false;\n";
+            if (rules.has(FieldRules::LengthConstraints) || rules.has(FieldRules::Pattern) || rules.has(FieldRules::Utf8))
+            {
+                out += "        {\n            const char *str = value.as<const char *>();\n            size_t length = strlen(str);\n            size_t measured = length;\n";
+                if (rules.has(FieldRules::Utf8))
+                    out += String("            if (!PatUtf8::validate(str, length, ") + (rules.has(FieldRules::CodePoints) ? "&measured" : "nullptr") + "))\n                return false;\n";
+                if (rules.has(FieldRules::LengthConstraints))
+                    out += "            if ((long)measured < " + String((long)rules.minLength) + " || (long)measured > " + String((long)rules.maxLength) + ")\n                return false;\n";
+                if (rules.has(FieldRules::Pattern))
+                {
+                    String budget = String((unsigned long)(rules.patternBudget ? rules.patternBudget : PAT_REGEX_STEP_BUDGET)) + "UL";
+                    out += "            if (PatRegex::search(" + functionName + "_pattern" + String(patternIndex++) + ", str, str + length, " + budget + ") != PatRegexResult::Match)\n                return false;\n";
+                }
+                out += "        }\n";
+            }
+            break;
+        case FieldType::Array:
+            out += "        if (!value.is<JsonArray>())\n            return false;\n";
+            if (rules.has(FieldRules::ItemsConstraints))
+                out += "        if ((int)value.as<JsonArray>().size() < " + String((long)rules.minItems) + " || (int)value.as<JsonArray>().size() > " + String((long)rules.maxItems) + ")\n            return false;\n";
+            break;
+        default:
+            out += "        return false; // unknown type\n";
+            break;
+        }
+    }
+    //----------------------------------------------
+    // Probe generation
+    static size_t maxLength(const std::vector<String> &probes)
+    {
+        size_t longest = 0;
+        for (const String &probe : probes)
+            longest = std::max<size_t>(longest, probe.length());
+        return longest;
+    }
+
+    static String repeat(char c, long count)
+    {
+        String out;
+        for (long i = 0; i < count && i < 512; ++i)
+            out += c;
+        return out;
+    }
+
+    static String jsonString(const String &text)
+    {
+        String out = "\"";
+        for (unsigned i = 0; i < text.length(); ++i)
+        {
+            char c = text[i];
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    static String jsonFloat(float value)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    static String jsonArray(long size)
+    {
+        String out = "[";
+        for (long i = 0; i < size && i < 512; ++i)
+            out += i ? ",0" : "0";
+        return out + "]";
+    }
+
+    // Interesting JSON values for one set of rules: each side of every bound plus a wrong type
+    static void candidates(const FieldRules &rules, std::vector<String> &out)
+    {
+        out.push_back("null");
+        switch (rules.type)
+        {
+        case FieldType::Boolean:
+            out.push_back("true");
+            out.push_back("false");
+            out.push_back("0");
+            break;
+        case FieldType::Integer:
+        case FieldType::Float:
+        {
+            float low = rules.has(FieldRules::ValueConstraints) ? rules.minValue : 0.0f;
+            float high = rules.has(FieldRules::ValueConstraints) ? rules.maxValue : 100.0f;
+            if (rules.type == FieldType::Integer)
+            {
+                long lo = (long)std::max(low, -2147483000.0f), hi = (long)std::min(high, 2147483000.0f);
+                for (long v : {lo, lo - 1, lo + 1, hi, hi - 1, hi + 1, (lo + hi) / 2})
+                    out.push_back(String(v));
+                out.push_back("1.5");
+            }
+            else
+            {
+                out.push_back(jsonFloat(low));
+                out.push_back(jsonFloat(high));
+                out.push_back(jsonFloat(low - 1.0f));
+                out.push_back(jsonFloat(high + 1.0f));
+                out.push_back(jsonFloat((low + high) / 2));
+            }
+            out.push_back("\"1\"");
+            break;
+        }
+        case FieldType::String:
+        {
+            long low = rules.has(FieldRules::LengthConstraints) ? rules.minLength : 1;
+            long high = rules.has(FieldRules::LengthConstraints) ? std::min<long>(rules.maxLength, 300) : 16;
+            for (long length : {low, low - 1, high, high + 1})
+            {
+                if (length >= 0)
+                    out.push_back(jsonString(repeat('a', length)));
+            }
+            for (const char *sample : {"user@example.com", "Password1@", "admin", "192.168.1.1", "2025-01-01T10:20:30", "abc123", "ABC"})
+                out.push_back(jsonString(sample));
+            if (rules.has(FieldRules::Utf8))
+            {
+                for (long length : {low, high, high + 1})
+                {
+                    String text;
+                    for (long i = 0; i < length && i < 512; ++i)
+                        text += "\xC3\xA9"; // two bytes, one code point
+                    out.push_back(jsonString(text));
+                }
+                out.push_back(jsonString("a\xC3"));        // truncated sequence
+                out.push_back(jsonString("\xED\xA0\x80")); // surrogate
+                out.push_back(jsonString("\xC0\xAF"));     // overlong
+            }
+            out.push_back("7");
+            break;
+        }
+        case FieldType::Array:
+        {
+            long low = rules.has(FieldRules::ItemsConstraints) ? rules.minItems : 0;
+            long high = rules.has(FieldRules::ItemsConstraints) ? std::min<long>(rules.maxItems, 64) : 4;
+            for (long size : {low, low - 1, high, high + 1})
+            {
+                if (size >= 0)
+                    out.push_back(jsonArray(size));
+            }
+            out.push_back("{}");
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    static bool accepts(const std::vector<FieldSchema> &schemas, const String &json)
+    {
+        DynamicJsonDocument doc(json.length() * 4 + 128);
+        if (deserializeJson(doc, json.c_str()))
+            return false;
+        JsonVariant value = doc.as<JsonVariant>();
+        for (const FieldSchema &schema : schemas)
+        {
+            if (!schema.validate(value))
+                return false;
+        }
+        return true;
+    }
+
+    static String object(const std::vector<std::pair<String, String>> &members)
+    {
+        String out = "{";
+        for (size_t i = 0; i < members.size(); ++i)
+            out += (i ? "," : "") + jsonString(members[i].first) + ":" + members[i].second;
+        return out + "}";
+    }
+
+    static void buildProbes(const Validator &validator, std::vector<String> &probes)
+    {
+        // Base document: the first candidate each key's schemas accept
+        std::vector<std::pair<String, String>> base;
+        std::vector<std::pair<String, std::vector<String>>> perKey;
+        for (const auto &field : validator.fields())
+        {
+            std::vector<String> values;
+            for (const FieldSchema &schema : field.second)
+                candidates(schema.getRules(), values);
+            perKey.push_back(std::make_pair(field.first, values));
+            if (field.first.isEmpty())
+                continue;
+            for (const String &value : values)
+            {
+                if (accepts(field.second, value))
+                {
+                    base.push_back(std::make_pair(field.first, value));
+                    break;
+                }
+            }
+        }
+
+        probes.push_back("{}");
+        probes.push_back("[]");
+        probes.push_back(object(base));
+        for (const auto &key : perKey)
+        {
+            if (key.first.isEmpty())
+            {
+                for (const String &value : key.second)
+                    probes.push_back(value);
+                continue;
+            }
+            std::vector<std::pair<String, String>> without;
+            for (const auto &member : base)
+            {
+                if (member.first != key.first)
+                    without.push_back(member);
+            }
+            probes.push_back(object(without));
+            for (const String &value : key.second)
+            {
+                std::vector<std::pair<String, String>> mutated = without;
+                mutated.push_back(std::make_pair(key.first, value));
+                probes.push_back(object(mutated));
+            }
+        }
+    }
+};
+
+#endif // PAT_schemaCodegen_H
@@ -0,0 +1,281 @@
+#ifndef PAT_schemaLoader_H
+#define PAT_schemaLoader_H
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <climits>
+#include <algorithm>
+#include <initializer_list>
+#include "PAT_dataValidator.h"
+
+//===========================================================================================================================================
+// Runtime schema loading
+//
+// Maps a JSON-Schema subset onto FieldSchema/Validator so limits and patterns can change without a reflash:
+//
+//   {
+//     "type": "object",
+//     "properties": {
+//       "ssid":     { "type": "string",  "minLength": 3, "maxLength": 32 },
+//       "password": { "type": "string",  "minLength": 8, "maxLength": 64, "pattern": "^[A-Za-z0-9@#$%^&*+=]+$" },
+//       "channel":  { "type": "integer", "minimum": 1, "maximum": 13 },
+//       "gain":     { "type": "number",  "minimum": 0.0, "maximum": 1.5 },
+//       "dns":      { "type": "array",   "minItems": 1, "maxItems": 2 }
+//     },
+//     "required": ["ssid", "password"],
+//     "dependentRequired": { "dns": ["ssid"] },
+//     "additionalProperties": false,
+//     "maxProperties": 8
+//   }
+//
+// "dependentRequired" maps onto Validator::addRequiredIf (if "dns" is present, "ssid" must be too),
+// "additionalProperties": false onto setStrict and "maxProperties" onto setMaxKeys. A scalar "default"
+// maps onto FieldSchema::setDefault.
+// A root of "type":"array" with an object "items" loads the item schema (use Validator::isArrayValid on it);
+// "items" on a property is rejected, and so are other keywords on such a root (minItems, maxItems, ...),
+// which isArrayValid has no way to check.
+// A root with any other type becomes a whole-document field (Validator::addField(FieldSchema)).
+// Unknown constraint keywords are rejected rather than ignored, so a schema never silently validates less
+// than its author intended, and so are names in "required" or "dependentRequired" that have no entry in
+// "properties". Annotation keywords ($schema, $id, title, description) are accepted.
+//-------------------------------------------------------------------
+class SchemaLoader
+{
+public:
+    //----------------------------------------------
+    // Load a whole schema document into an empty validator. On failure the validator content is unspecified
+    // and must be discarded; the caller keeps serving from the previous one.
+    static bool load(const JsonVariant &schema, Validator &out, bool *isArraySchema = nullptr)
+    {
+        if (isArraySchema)
+            *isArraySchema = false;
+
+        if (!schema.is<JsonObject>())
+            return false;
+
+        const char *type = schema["type"].as<const char *>();
+        if (type == nullptr)
+            return false;
+
+        if (strcmp(type, "array") == 0 && schema["items"].is<JsonObject>())
+        {
+            if (isArraySchema)
+                *isArraySchema = true;
+            return onlyKeywords(schema, {"type", "items"}) && loadObject(schema["items"], out);
+        }
+
+        if (strcmp(type, "object") == 0)
+            return loadObject(schema, out);
+
+        FieldSchema field;
+        if (!loadField(schema, field))
+            return false;
+        out.addField(field.setRequired(true));
+        return true;
+    }
+    //----------------------------------------------
+    // Load one property schema into a FieldSchema.
+    static bool loadField(const JsonVariant &property, FieldSchema &out)
+    {
+        if (!property.is<JsonObject>())
+            return false;
+
+        const char *type = property["type"].as<const char *>();
+        if (type == nullptr)
+            return false;
+
+        if (strcmp(type, "number") == 0)
+            out.setType("float"); // FieldSchema calls JSON-Schema "number" a float
+        else if (strcmp(type, "string") == 0 || strcmp(type, "integer") == 0 || strcmp(type, "float") == 0 ||
+                 strcmp(type, "boolean") == 0 || strcmp(type, "array") == 0)
+            out.setType(type);
+        else
+            return false;
+
+        Bounds bounds;
+        for (JsonPair kv : property.as<JsonObject>())
+        {
+            const char *key = kv.key().c_str();
+            JsonVariant value = kv.value();
+
+            if (strcmp(key, "type") == 0 || strcmp(key, "$schema") == 0 || strcmp(key, "$id") == 0 || strcmp(key, "title") == 0)
+                continue;
+            if (strcmp(key, "description") == 0)
+            {
+                out.setDescription(value.as<String>());
+                continue;
+            }
+            if (strcmp(key, "items") == 0)
+                return false; // element schemas of a property are not checked; load them into their own array validator
+            if (strcmp(key, "pattern") == 0)
+            {
+                if (!value.is<const char *>())
+                    return false;
+                out.setPattern(value.as<String>());
+                continue;
+            }
+            if (strcmp(key, "default") == 0)
+            {
+                if (value.is<bool>())
+                    out.setDefault(value.as<bool>());
+                else if (value.is<int>())
+                    out.setDefault(value.as<int>());
+                else if (value.is<double>())
+                    out.setDefault(value.as<double>());
+                else if (value.is<const char *>())
+                    out.setDefault(value.as<const char *>());
+                else
+                    return false; // object and array defaults are not supported
+                continue;
+            }
+
+            if (!bounds.collect(key, value))
+                return false;
+        }
+        bounds.applyTo(out);
+        return !out.hasPatternError();
+    }
+    //----------------------------------------------
+private:
+    static bool loadObject(const JsonVariant &schema, Validator &out)
+    {
+        if (!schema["properties"].is<JsonObject>())
+            return false;
+        if (!onlyKeywords(schema, {"type", "properties", "required", "dependentRequired", "additionalProperties", "maxProperties"}))
+            return false;
+
+        JsonVariant required = schema["required"];
+        if (!required.isNull() && !required.is<JsonArray>())
+            return false;
+
+        for (JsonPair kv : schema["properties"].as<JsonObject>())
+        {
+            FieldSchema field;
+            if (!loadField(kv.value(), field))
+                return false;
+
+            for (JsonVariant name : required.as<JsonArray>())
+            {
+                const char *requiredName = name.as<const char *>();
+                if (requiredName != nullptr && strcmp(requiredName, kv.key().c_str()) == 0)
+                {
+                    field.setRequired(true);
+                    break;
+                }
+            }
+            out.addField(String(kv.key().c_str()), field);
+        }
+        for (JsonVariant name : required.as<JsonArray>())
+        {
+            // A required key without a property schema would otherwise be dropped silently
+            if (!name.is<const char *>() || !schema["properties"].containsKey(name.as<const char *>()))
+                return false;
+        }
+        return loadDependentRequired(schema["dependentRequired"], schema["properties"], out) && loadObjectLimits(schema, out);
+    }
+
+    // False when `schema` has a keyword outside `known` and the annotations, e.g. minProperties or allOf
+    static bool onlyKeywords(const JsonVariant &schema, std::initializer_list<const char *> known)
+    {
+        for (JsonPair kv : schema.as<JsonObject>())
+        {
+            const char *key = kv.key().c_str();
+            if (isAnnotation(key))
+                continue;
+            if (std::none_of(known.begin(), known.end(), [key](const char *name)
+                             { return strcmp(name, key) == 0; }))
+                return false;
+        }
+        return true;
+    }
+
+    static bool isAnnotation(const char *key)
+    {
+        return strcmp(key, "$schema") == 0 || strcmp(key, "$id") == 0 || strcmp(key, "title") == 0 || strcmp(key, "description") == 0;
+    }
+
+    static bool loadObjectLimits(const JsonVariant &schema, Validator &out)
+    {
+        JsonVariant additional = schema["additionalProperties"];
+        if (!additional.isNull())
+        {
+            if (!additional.is<bool>())
+                return false; // property schemas for unknown keys are not supported
+            out.setStrict(!additional.as<bool>());
+        }
+        JsonVariant maxProperties = schema["maxProperties"];
+        if (!maxProperties.isNull())
+        {
+            if (!maxProperties.is<int>() || maxProperties.as<int>() < 1 || maxProperties.as<int>() > UINT16_MAX)
+                return false;
+            out.setMaxKeys(maxProperties.as<int>());
+        }
+        return true;
+    }
+
+    // Every name must be a loaded property: a rule on an unknown key would reject every document
+    static bool loadDependentRequired(const JsonVariant &dependent, const JsonVariant &properties, Validator &out)
+    {
+        if (dependent.isNull())
+            return true;
+        if (!dependent.is<JsonObject>())
+            return false;
+        for (JsonPair kv : dependent.as<JsonObject>())
+        {
+            if (!kv.value().is<JsonArray>() || !properties.containsKey(kv.key().c_str()))
+                return false;
+            for (JsonVariant name : kv.value().as<JsonArray>())
+            {
+                if (!name.is<const char *>() || !properties.containsKey(name.as<const char *>()))
+                    return false;
+                out.addRequiredIf(name.as<String>(), String(kv.key().c_str()));
+            }
+        }
+        return true;
+    }
+    //----------------------------------------------
+    // JSON Schema lets each bound stand alone while FieldSchema checks both together, so bounds are
+    // collected first and the missing side is opened up to the widest value the type can hold.
+    struct Bounds
+    {
+        bool hasMinValue = false, hasMaxValue = false, hasMinLength = false, hasMaxLength = false, hasMinItems = false, hasMaxItems = false;
+        float minValue = -FLT_MAX, maxValue = FLT_MAX;
+        int minLength = 0, maxLength = INT_MAX;
+        int minItems = 0, maxItems = INT_MAX;
+
+        bool collect(const char *key, const JsonVariant &value)
+        {
+            if (!value.is<float>())
+                return false;
+
+            if (strcmp(key, "minimum") == 0)
+                hasMinValue = true, minValue = value.as<float>();
+            else if (strcmp(key, "maximum") == 0)
+                hasMaxValue = true, maxValue = value.as<float>();
+            else if (!value.is<int>())
+                return false; // Counts must be whole numbers; 2.5 would otherwise be truncated
+            else if (strcmp(key, "minLength") == 0)
+                hasMinLength = true, minLength = value.as<int>();
+            else if (strcmp(key, "maxLength") == 0)
+                hasMaxLength = true, maxLength = value.as<int>();
+            else if (strcmp(key, "minItems") == 0)
+                hasMinItems = true, minItems = value.as<int>();
+            else if (strcmp(key, "maxItems") == 0)
+                hasMaxItems = true, maxItems = value.as<int>();
+            else
+                return false;
+            return true;
+        }
+
+        void applyTo(FieldSchema &out) const
+        {
+            if (hasMinValue || hasMaxValue)
+                out.setValue(minValue, maxValue);
+            if (hasMinLength || hasMaxLength)
+                out.setLength(minLength, maxLength);
+            if (hasMinItems || hasMaxItems)
+                out.setItems(minItems, maxItems);
+        }
+    };
+};
+
+#endif // PAT_schemaLoader_H
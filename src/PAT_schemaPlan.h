@@ -0,0 +1,465 @@
+#ifndef PAT_schemaPlan_H
+#define PAT_schemaPlan_H
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include "PAT_dataValidator.h"
+#include "PAT_APIConfig.h"
+
+//===========================================================================================================================================
+// Binary schema plans
+//
+// A plan is the compiled form of a set of named Validators as one position-independent blob: every
+// reference is an offset from the start of the blob, and the rule records are the FieldRules that
+// FieldSchema uses internally. The blob is used in place - from a flash partition mapped with
+// esp_partition_mmap() on the ESP32 or an mmap()ed file on Linux - with no deserialisation step.
+//
+//   Layout (little-endian, 4-byte aligned):
+//     PlanHeader
+//     PlanValidatorEntry[validatorCount]   sorted by name
+//     PlanKeyEntry[keyCount]               per validator, sorted by name
+//     PlanRuleEntry[ruleCount]
+//     string table                         NUL-terminated names and pattern sources
+//     program table                        PlanProgram + PatRegexInst[] + PatRegexClass[] per pattern
+//
+// SchemaPlanBuilder produces the blob (at build time on the host, or once on the device before writing
+// it to flash). SchemaPlan::load() checks magic, version, CRC-32, every offset and every regex program
+// once; lookups and validations after that trust the blob. Patterns are stored compiled, so loading a
+// plan allocates nothing and regexes execute straight from flash.
+//-------------------------------------------------------------------
+#define SCHEMA_PLAN_MAGIC 0x53544150UL // "PATS"
+#define SCHEMA_PLAN_VERSION 2
+#define SCHEMA_PLAN_NO_PATTERN 0xFFFFFFFFUL
+
+struct PlanHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t totalSize;
+    uint32_t crc32; // Over everything after the header
+    uint32_t validatorCount;
+    uint32_t validatorsOffset;
+    uint32_t keyCount;
+    uint32_t keysOffset;
+    uint32_t ruleCount;
+    uint32_t rulesOffset;
+    uint32_t stringsOffset;
+    uint32_t stringsSize;
+    uint32_t programsOffset;
+    uint32_t programsSize;
+};
+
+struct PlanValidatorEntry
+{
+    uint32_t nameOffset; // Into the string table
+    uint32_t firstKey;
+    uint32_t keyCount;
+};
+
+struct PlanKeyEntry
+{
+    uint32_t nameOffset; // Into the string table, "" validates the whole document
+    uint32_t firstRule;
+    uint32_t ruleCount;
+};
+
+struct PlanRuleEntry
+{
+    FieldRules rules;
+    uint32_t patternOffset; // Into the string table, SCHEMA_PLAN_NO_PATTERN if none
+    uint32_t programOffset; // Into the program table, SCHEMA_PLAN_NO_PATTERN if none
+};
+
+struct PlanProgram
+{
+    uint32_t instCount; // PatRegexInst[instCount] follow, then PatRegexClass[classCount]
+    uint32_t classCount;
+    uint16_t flags;
+    uint16_t slots;
+};
+
+static_assert(sizeof(PlanHeader) == 56, "PlanHeader layout changed, bump SCHEMA_PLAN_VERSION");
+static_assert(sizeof(FieldRules) == 32, "FieldRules layout changed, bump SCHEMA_PLAN_VERSION");
+static_assert(sizeof(PlanRuleEntry) == 40, "PlanRuleEntry layout changed, bump SCHEMA_PLAN_VERSION");
+static_assert(sizeof(PlanProgram) == 12, "PlanProgram layout changed, bump SCHEMA_PLAN_VERSION");
+static_assert(sizeof(PatRegexInst) == 8 && sizeof(PatRegexClass) == 32, "Regex program layout changed, bump SCHEMA_PLAN_VERSION");
+//-------------------------------------------------------------------
+// CRC-32 (IEEE 802.3), nibble table to keep the flash footprint small
+//-------------------------------------------------------------------
+inline uint32_t schemaPlanCrc32(const uint8_t *data, size_t length, uint32_t crc = 0)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+//-------------------------------------------------------------------
+// Plan builder
+//-------------------------------------------------------------------
+class SchemaPlanBuilder
+{
+public:
+    //----------------------------------------------
+    SchemaPlanBuilder &add(const String &name, const Validator &validator)
+    {
+        entries_.push_back(std::make_pair(name, &validator));
+        return *this;
+    }
+    //----------------------------------------------
+    // Registers "<METHOD> <url>" for the body validator and "<METHOD> <url>[]" for the array validator.
+    SchemaPlanBuilder &add(const APIStruct &api)
+    {
+        String name = api.method + " " + api.url;
+        if (api.hasValidator)
+            add(name, api.bodyValid);
+        if (api.hasArrayValidator)
+            add(name + "[]", api.bodyArrayValid);
+        return *this;
+    }
+    //----------------------------------------------
+    // Fails on duplicate names, broken patterns, defaults, encrypted fields and validators with cross-field rules or strict mode.
+    bool build(std::vector<uint8_t> &out) const
+    {
+        std::vector<std::pair<String, const Validator *>> sorted = entries_;
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<String, const Validator *> &a, const std::pair<String, const Validator *> &b)
+                  { return strcmp(a.first.c_str(), b.first.c_str()) < 0; });
+        for (size_t i = 1; i < sorted.size(); ++i)
+        {
+            if (sorted[i - 1].first == sorted[i].first)
+                return false; // duplicate validator name
+        }
+
+        std::vector<PlanValidatorEntry> validators;
+        std::vector<PlanKeyEntry> keys;
+        std::vector<PlanRuleEntry> rules;
+        std::vector<uint8_t> strings;
+        std::vector<uint8_t> programs;
+
+        for (const auto &entry : sorted)
+        {
+            if (entry.second->hasCrossFieldRules() || entry.second->isStrict() || entry.second->maxKeys())
+                return false; // not representable in a plan, validate with the Validator itself
+            PlanValidatorEntry v = {addString(strings, entry.first), (uint32_t)keys.size(), 0};
+            // std::map is ordered by String, which compares like strcmp - the order lookups rely on
+            for (const auto &field : entry.second->fields())
+            {
+                PlanKeyEntry k = {addString(strings, field.first), (uint32_t)rules.size(), (uint32_t)field.second.size()};
+                for (const FieldSchema &schema : field.second)
+                {
+                    if (schema.hasPatternError() || schema.hasDefault() || schema.getCipher())
+                        return false; // defaults and ciphers live outside FieldRules
+                    PlanRuleEntry r;
+                    memset(&r, 0, sizeof(r));
+                    r.rules = schema.getRules();
+                    r.patternOffset = SCHEMA_PLAN_NO_PATTERN;
+                    r.programOffset = SCHEMA_PLAN_NO_PATTERN;
+                    if (r.rules.has(FieldRules::Pattern))
+                    {
+                        r.patternOffset = addString(strings, schema.getPattern());
+                        r.programOffset = addProgram(programs, schema.getCompiledPattern()->view());
+                    }
+                    rules.push_back(r);
+                }
+                keys.push_back(k);
+                ++v.keyCount;
+            }
+            validators.push_back(v);
+        }
+        if (strings.empty())
+            strings.push_back(0);
+        while (strings.size() % 4)
+            strings.push_back(0);
+
+        PlanHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = SCHEMA_PLAN_MAGIC;
+        header.version = SCHEMA_PLAN_VERSION;
+        header.headerSize = sizeof(PlanHeader);
+        header.validatorCount = validators.size();
+        header.validatorsOffset = sizeof(PlanHeader);
+        header.keyCount = keys.size();
+        header.keysOffset = header.validatorsOffset + validators.size() * sizeof(PlanValidatorEntry);
+        header.ruleCount = rules.size();
+        header.rulesOffset = header.keysOffset + keys.size() * sizeof(PlanKeyEntry);
+        header.stringsOffset = header.rulesOffset + rules.size() * sizeof(PlanRuleEntry);
+        header.stringsSize = strings.size();
+        header.programsOffset = header.stringsOffset + strings.size();
+        header.programsSize = programs.size();
+        header.totalSize = header.programsOffset + programs.size();
+
+        out.assign(header.totalSize, 0);
+        appendAt(out, header.validatorsOffset, validators.data(), validators.size() * sizeof(PlanValidatorEntry));
+        appendAt(out, header.keysOffset, keys.data(), keys.size() * sizeof(PlanKeyEntry));
+        appendAt(out, header.rulesOffset, rules.data(), rules.size() * sizeof(PlanRuleEntry));
+        appendAt(out, header.stringsOffset, strings.data(), strings.size());
+        appendAt(out, header.programsOffset, programs.data(), programs.size());
+        header.crc32 = schemaPlanCrc32(out.data() + sizeof(PlanHeader), header.totalSize - sizeof(PlanHeader));
+        memcpy(out.data(), &header, sizeof(header));
+        return true;
+    }
+    //----------------------------------------------
+private:
+    std::vector<std::pair<String, const Validator *>> entries_;
+
+    static uint32_t addString(std::vector<uint8_t> &strings, const String &value)
+    {
+        uint32_t offset = strings.size();
+        strings.insert(strings.end(), value.c_str(), value.c_str() + value.length() + 1);
+        return offset;
+    }
+
+    static uint32_t addProgram(std::vector<uint8_t> &programs, const PatRegexView &program)
+    {
+        uint32_t offset = programs.size();
+        PlanProgram p = {program.instCount, program.classCount, program.flags, program.slots};
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&p);
+        programs.insert(programs.end(), bytes, bytes + sizeof(p));
+        bytes = reinterpret_cast<const uint8_t *>(program.insts);
+        programs.insert(programs.end(), bytes, bytes + program.instCount * sizeof(PatRegexInst));
+        bytes = reinterpret_cast<const uint8_t *>(program.classes);
+        programs.insert(programs.end(), bytes, bytes + program.classCount * sizeof(PatRegexClass));
+        return offset;
+    }
+
+    static void appendAt(std::vector<uint8_t> &out, uint32_t offset, const void *data, size_t size)
+    {
+        if (size)
+            memcpy(out.data() + offset, data, size);
+    }
+};
+//-------------------------------------------------------------------
+// Plan view
+//-------------------------------------------------------------------
+class SchemaPlan;
+
+class PlanValidator
+{
+public:
+    PlanValidator() = default;
+    explicit operator bool() const { return plan_ != nullptr; }
+
+    bool isValid(const JsonVariant &json) const
+    {
+        ValidationContext ctx;
+        return isValid(json, ctx);
+    }
+    bool isValid(const JsonVariant &json, ValidationContext &ctx) const;
+
+    bool isArrayValid(const JsonVariant &arrays) const
+    {
+        ValidationContext ctx;
+        return isArrayValid(arrays, ctx);
+    }
+    bool isArrayValid(const JsonVariant &arrays, ValidationContext &ctx) const
+    {
+        if (!arrays.is<JsonArray>())
+            return ctx.fail(ValidationError::WrongType);
+        for (const JsonVariant &item : arrays.as<JsonArray>())
+        {
+            if (!isValid(item, ctx))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    friend class SchemaPlan;
+    PlanValidator(const SchemaPlan *plan, const PlanValidatorEntry *entry) : plan_(plan), entry_(entry) {}
+
+    const SchemaPlan *plan_ = nullptr;
+    const PlanValidatorEntry *entry_ = nullptr;
+};
+
+class SchemaPlan
+{
+public:
+    SchemaPlan() = default;
+    SchemaPlan(const SchemaPlan &) = delete;
+    SchemaPlan &operator=(const SchemaPlan &) = delete;
+    //----------------------------------------------
+    // Validate the blob once. `data` must stay mapped for the lifetime of this object and be 4-byte aligned.
+    bool load(const void *data, size_t size)
+    {
+        base_ = nullptr;
+
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        if (bytes == nullptr || (reinterpret_cast<uintptr_t>(bytes) & 3) != 0 || size < sizeof(PlanHeader))
+            return false;
+
+        const PlanHeader *header = reinterpret_cast<const PlanHeader *>(bytes);
+        if (header->magic != SCHEMA_PLAN_MAGIC || header->version != SCHEMA_PLAN_VERSION ||
+            header->headerSize != sizeof(PlanHeader) || header->totalSize > size || header->totalSize < sizeof(PlanHeader))
+            return false;
+
+        if (!sectionFits(*header, header->validatorsOffset, header->validatorCount, sizeof(PlanValidatorEntry)) ||
+            !sectionFits(*header, header->keysOffset, header->keyCount, sizeof(PlanKeyEntry)) ||
+            !sectionFits(*header, header->rulesOffset, header->ruleCount, sizeof(PlanRuleEntry)) ||
+            !sectionFits(*header, header->stringsOffset, header->stringsSize, 1) ||
+            !sectionFits(*header, header->programsOffset, header->programsSize, 1))
+            return false;
+
+        if (schemaPlanCrc32(bytes + sizeof(PlanHeader), header->totalSize - sizeof(PlanHeader)) != header->crc32)
+            return false;
+
+        // Every string must be NUL-terminated inside the table
+        if (header->stringsSize == 0 || bytes[header->stringsOffset + header->stringsSize - 1] != 0)
+            return false;
+
+        base_ = bytes;
+        header_ = header;
+        if (!checkReferences())
+        {
+            base_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+    //----------------------------------------------
+    bool isLoaded() const { return base_ != nullptr; }
+    size_t validatorCount() const { return base_ ? header_->validatorCount : 0; }
+    //----------------------------------------------
+    // Binary search by name; returns an empty PlanValidator when not found.
+    PlanValidator find(const char *name) const
+    {
+        if (!base_)
+            return PlanValidator();
+        const PlanValidatorEntry *validators = validatorEntries();
+        size_t lo = 0, hi = header_->validatorCount;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            int cmp = strcmp(string(validators[mid].nameOffset), name);
+            if (cmp == 0)
+                return PlanValidator(this, &validators[mid]);
+            if (cmp < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return PlanValidator();
+    }
+    //----------------------------------------------
+private:
+    friend class PlanValidator;
+
+    const uint8_t *base_ = nullptr;
+    const PlanHeader *header_ = nullptr;
+
+    const PlanValidatorEntry *validatorEntries() const { return reinterpret_cast<const PlanValidatorEntry *>(base_ + header_->validatorsOffset); }
+    const PlanKeyEntry *keyEntries() const { return reinterpret_cast<const PlanKeyEntry *>(base_ + header_->keysOffset); }
+    const PlanRuleEntry *ruleEntries() const { return reinterpret_cast<const PlanRuleEntry *>(base_ + header_->rulesOffset); }
+    const char *string(uint32_t offset) const { return reinterpret_cast<const char *>(base_ + header_->stringsOffset + offset); }
+
+    // Regex program of a rule, pointing into the blob
+    PatRegexView program(const PlanRuleEntry &rule) const
+    {
+        const uint8_t *at = base_ + header_->programsOffset + rule.programOffset;
+        const PlanProgram *p = reinterpret_cast<const PlanProgram *>(at);
+        PatRegexView view;
+        view.insts = reinterpret_cast<const PatRegexInst *>(at + sizeof(PlanProgram));
+        view.instCount = p->instCount;
+        view.classes = reinterpret_cast<const PatRegexClass *>(at + sizeof(PlanProgram) + p->instCount * sizeof(PatRegexInst));
+        view.classCount = p->classCount;
+        view.flags = p->flags;
+        view.slots = p->slots;
+        return view;
+    }
+
+    bool programFits(const PlanRuleEntry &rule) const
+    {
+        uint64_t offset = rule.programOffset;
+        if ((offset & 3) != 0 || offset + sizeof(PlanProgram) > header_->programsSize)
+            return false;
+        const PlanProgram *p = reinterpret_cast<const PlanProgram *>(base_ + header_->programsOffset + offset);
+        uint64_t end = offset + sizeof(PlanProgram) + (uint64_t)p->instCount * sizeof(PatRegexInst) + (uint64_t)p->classCount * sizeof(PatRegexClass);
+        return end <= header_->programsSize && PatRegex::verify(program(rule));
+    }
+
+    static bool sectionFits(const PlanHeader &header, uint32_t offset, uint32_t count, uint32_t elementSize)
+    {
+        uint64_t end = (uint64_t)offset + (uint64_t)count * elementSize;
+        return offset >= sizeof(PlanHeader) && (offset & 3) == 0 && end <= header.totalSize;
+    }
+
+    bool checkReferences() const
+    {
+        const PlanValidatorEntry *validators = validatorEntries();
+        for (uint32_t i = 0; i < header_->validatorCount; ++i)
+        {
+            const PlanValidatorEntry &v = validators[i];
+            if (v.nameOffset >= header_->stringsSize || (uint64_t)v.firstKey + v.keyCount > header_->keyCount)
+                return false;
+            if (i > 0 && strcmp(string(validators[i - 1].nameOffset), string(v.nameOffset)) >= 0)
+                return false;
+        }
+        const PlanKeyEntry *keys = keyEntries();
+        for (uint32_t i = 0; i < header_->keyCount; ++i)
+        {
+            if (keys[i].nameOffset >= header_->stringsSize || (uint64_t)keys[i].firstRule + keys[i].ruleCount > header_->ruleCount)
+                return false;
+        }
+        const PlanRuleEntry *rules = ruleEntries();
+        for (uint32_t i = 0; i < header_->ruleCount; ++i)
+        {
+            const PlanRuleEntry &r = rules[i];
+            if (r.rules.type == FieldType::Unknown || r.rules.type > FieldType::Array)
+                return false;
+            if (r.rules.has(FieldRules::Pattern) && (r.patternOffset >= header_->stringsSize || !programFits(r)))
+                return false;
+        }
+        return true;
+    }
+};
+//-------------------------------------------------------------------
+// Same walk as Validator::isValid, over plan records
+inline bool PlanValidator::isValid(const JsonVariant &json, ValidationContext &ctx) const
+{
+    if (!plan_)
+        return ctx.fail(ValidationError::WrongType);
+
+    const PlanKeyEntry *keys = plan_->keyEntries() + entry_->firstKey;
+    const PlanRuleEntry *rules = plan_->ruleEntries();
+    for (uint32_t k = 0; k < entry_->keyCount; ++k)
+    {
+        const char *name = plan_->string(keys[k].nameOffset);
+        const PlanRuleEntry *first = rules + keys[k].firstRule;
+        const PlanRuleEntry *last = first + keys[k].ruleCount;
+        ctx.field = name;
+
+        JsonVariant value;
+        if (name[0] == '\0')
+            value = json; // whole document, even with a "" member
+        else if (json.containsKey(name))
+            value = json[name];
+        else
+        {
+            for (const PlanRuleEntry *r = first; r != last; ++r)
+            {
+                if (r->rules.has(FieldRules::Required))
+                    return ctx.fail(ValidationError::MissingRequired);
+            }
+            continue;
+        }
+
+        for (const PlanRuleEntry *r = first; r != last; ++r)
+        {
+            PatRegexView program;
+            if (r->rules.has(FieldRules::Pattern))
+                program = plan_->program(*r);
+            if (!FieldSchema::validateRules(r->rules, r->rules.has(FieldRules::Pattern) ? &program : nullptr, value, ctx))
+                return false;
+        }
+    }
+    return true;
+}
+
+#endif // PAT_schemaPlan_H
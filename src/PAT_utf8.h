@@ -0,0 +1,110 @@
+#ifndef PAT_utf8_H
+#define PAT_utf8_H
+#include <Arduino.h>
+#include <cstring>
+#include <cstdint>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+//===========================================================================================================================================
+// UTF-8 validation
+//
+// Checks that a byte range is well-formed UTF-8 (RFC 3629: no overlong forms, no surrogates, nothing above
+// U+10FFFF, no truncated sequences) and counts its code points in the same pass. Runs of ASCII are skipped
+// a block at a time - 32 bytes with AVX2, 16 with SSE2, two machine words (8 bytes on the ESP32) otherwise
+// - so ASCII-heavy strings cost about as much as strlen(). Only the multi-byte sequences are decoded.
+//-------------------------------------------------------------------
+class PatUtf8
+{
+public:
+    // `codePoints` (optional) receives the number of code points when the range is valid
+    static bool validate(const char *str, size_t length, size_t *codePoints = nullptr)
+    {
+        const uint8_t *p = (const uint8_t *)str;
+        const uint8_t *end = p + length;
+        size_t continuation = 0;
+        while (p < end)
+        {
+            p = skipAscii(p, end);
+            if (p == end)
+                break;
+
+            uint8_t lead = *p;
+            uint8_t low = 0x80, high = 0xBF; // allowed range of the second byte
+            size_t need;
+            if (lead >= 0xC2 && lead <= 0xDF)
+                need = 1;
+            else if (lead >= 0xE0 && lead <= 0xEF)
+            {
+                need = 2;
+                if (lead == 0xE0)
+                    low = 0xA0; // overlong
+                else if (lead == 0xED)
+                    high = 0x9F; // surrogates
+            }
+            else if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                need = 3;
+                if (lead == 0xF0)
+                    low = 0x90; // overlong
+                else if (lead == 0xF4)
+                    high = 0x8F; // above U+10FFFF
+            }
+            else
+                return false; // continuation byte, C0/C1 overlong or F5..FF
+
+            if ((size_t)(end - p) <= need || p[1] < low || p[1] > high)
+                return false;
+            for (size_t i = 2; i <= need; ++i)
+            {
+                if ((p[i] & 0xC0) != 0x80)
+                    return false;
+            }
+            continuation += need;
+            p += need + 1;
+        }
+        if (codePoints)
+            *codePoints = length - continuation;
+        return true;
+    }
+
+private:
+    // First byte >= 0x80 in [p, end), or end
+    static const uint8_t *skipAscii(const uint8_t *p, const uint8_t *end)
+    {
+#if defined(__AVX2__)
+        while (end - p >= 32)
+        {
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)p));
+            if (mask)
+                return p + __builtin_ctz(mask);
+            p += 32;
+        }
+#endif
+#if defined(__SSE2__)
+        while (end - p >= 16)
+        {
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p));
+            if (mask)
+                return p + __builtin_ctz(mask);
+            p += 16;
+        }
+#endif
+        const uintptr_t highBits = (uintptr_t)0x8080808080808080ULL;
+        while ((size_t)(end - p) >= 2 * sizeof(uintptr_t))
+        {
+            uintptr_t a, b;
+            memcpy(&a, p, sizeof(a)); // unaligned-safe, compiles to plain loads
+            memcpy(&b, p + sizeof(a), sizeof(b));
+            if ((a | b) & highBits)
+                break;
+            p += 2 * sizeof(uintptr_t);
+        }
+        while (p < end && *p < 0x80)
+            ++p;
+        return p;
+    }
+};
+
+#endif // PAT_utf8_H
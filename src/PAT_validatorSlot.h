@@ -0,0 +1,129 @@
+#ifndef PAT_validatorSlot_H
+#define PAT_validatorSlot_H
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include <mutex>
+#include "PAT_dataValidator.h"
+#include "PAT_schemaLoader.h"
+
+//===========================================================================================================================================
+// Hot-reloadable validator (read-copy-update)
+//
+// Request handlers read the current Validator through a ReadGuard; a reload compiles a fresh Validator
+// off the hot path, publishes it with one atomic pointer swap and reclaims the old one once every reader
+// that might still hold it has left. Readers never take a lock and never wait for a reload.
+//
+//   ValidatorSlot configSchema;
+//   configSchema.reload(schemaDoc.as<JsonVariant>());          // e.g. from an OTA/config task
+//
+//   {
+//       ValidatorSlot::ReadGuard current = configSchema.read(); // in the HTTP/MQTT handler
+//       if (current && current->isValid(body))
+//           ...
+//   }
+//
+// Grace periods are tracked with two reader counters indexed by generation parity. A reader announces
+// itself on the current parity, re-checks the generation and only then loads the pointer; the writer swaps
+// the pointer, advances the generation and waits for the previous parity to drain before deleting. Only
+// the writer ever waits, so a reload may take as long as the slowest in-flight validation.
+//-------------------------------------------------------------------
+class ValidatorSlot
+{
+public:
+    //----------------------------------------------
+    class ReadGuard
+    {
+    public:
+        ReadGuard(ReadGuard &&other) : counter_(other.counter_), validator_(other.validator_)
+        {
+            other.counter_ = nullptr;
+            other.validator_ = nullptr;
+        }
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+        ~ReadGuard()
+        {
+            if (counter_)
+                counter_->fetch_sub(1);
+        }
+
+        const Validator *operator->() const { return validator_; }
+        const Validator &operator*() const { return *validator_; }
+        explicit operator bool() const { return validator_ != nullptr; }
+
+    private:
+        friend class ValidatorSlot;
+        ReadGuard(std::atomic<uint32_t> *counter, const Validator *validator) : counter_(counter), validator_(validator) {}
+
+        std::atomic<uint32_t> *counter_;
+        const Validator *validator_;
+    };
+    //----------------------------------------------
+    ValidatorSlot() = default;
+    explicit ValidatorSlot(Validator *initial) : current_(initial) {}
+    ValidatorSlot(const ValidatorSlot &) = delete;
+    ValidatorSlot &operator=(const ValidatorSlot &) = delete;
+    ~ValidatorSlot()
+    {
+        delete current_.load();
+    }
+    //----------------------------------------------
+    // Wait-free apart from the retry when a reload flips the generation between the two loads.
+    ReadGuard read() const
+    {
+        for (;;)
+        {
+            uint32_t generation = generation_.load();
+            std::atomic<uint32_t> &counter = readers_[generation & 1];
+            counter.fetch_add(1);
+            if (generation_.load() == generation)
+                return ReadGuard(&counter, current_.load());
+            counter.fetch_sub(1);
+        }
+    }
+    //----------------------------------------------
+    // Takes ownership of `fresh`. Blocks the calling (writer) task until readers of the replaced validator
+    // are done; concurrent publishers are serialised.
+    void publish(Validator *fresh)
+    {
+        std::lock_guard<std::mutex> writer(writerLock_);
+
+        Validator *old = current_.exchange(fresh);
+        uint32_t previous = generation_.fetch_add(1);
+        while (readers_[previous & 1].load() != 0)
+        {
+            delay(1);
+        }
+        delete old;
+        reloads_.fetch_add(1);
+    }
+    //----------------------------------------------
+    // Compile a JSON schema (see SchemaLoader) and publish it. A schema that fails to load is dropped and
+    // the current validator keeps serving.
+    bool reload(const JsonVariant &schema)
+    {
+        Validator *fresh = new Validator();
+        if (!SchemaLoader::load(schema, *fresh))
+        {
+            delete fresh;
+            failedReloads_.fetch_add(1);
+            return false;
+        }
+        publish(fresh);
+        return true;
+    }
+    //----------------------------------------------
+    uint32_t reloads() const { return reloads_.load(); }
+    uint32_t failedReloads() const { return failedReloads_.load(); }
+    //----------------------------------------------
+private:
+    std::atomic<Validator *> current_{nullptr};
+    std::atomic<uint32_t> generation_{0};
+    mutable std::atomic<uint32_t> readers_[2] = {{0}, {0}};
+    std::atomic<uint32_t> reloads_{0};
+    std::atomic<uint32_t> failedReloads_{0};
+    std::mutex writerLock_;
+};
+
+#endif // PAT_validatorSlot_H
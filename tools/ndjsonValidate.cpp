@@ -0,0 +1,382 @@
+//===========================================================================================================================================
+// ndjsonValidate - Linux host tool
+//
+// Re-validates archived payloads (one JSON document per line) against a JSON schema file with the same
+// Validator code the devices run:
+//
+//   ndjsonValidate [-j threads] [-q] [-c capacity] <schema.json> <payloads.ndjson>
+//     stdout: "<line>\tok" or "<line>\t<error>\t<key>" per non-empty line (-q: failures only)
+//     stderr: summary counters and throughput
+//     exit:   0 all lines valid, 1 some line invalid, 2 usage or I/O error
+//
+// The input is mmap'ed and cut into chunks on line boundaries. Chunks are dealt to per-thread deques;
+// a thread that runs dry steals from the back of another one's deque. Each thread parses into its own
+// JsonDocument, sized from the schema (Validator::documentCapacity, or -c when the schema does not bound
+// it) and filtered to the schema keys, so a line too large for the schema fails as it would on a device.
+// Verdicts are written in input order.
+//
+// Built against a host Arduino core (e.g. EpoxyDuino) plus ArduinoJson 6:
+//   g++ -std=gnu++17 -O2 -pthread -I<core> -I<ArduinoJson>/src -Isrc tools/ndjsonValidate.cpp src/PAT_dataValidator.cpp -o ndjsonValidate
+//-------------------------------------------------------------------
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../src/PAT_dataValidator.h"
+#include "../src/PAT_schemaLoader.h"
+
+#define NDJSON_CHUNK_BYTES (1u << 20) // Work unit; lines are never split
+#define NDJSON_DEFAULT_CAPACITY 65536 // Per-line document capacity when the schema does not bound it
+#define NDJSON_PARSE_ERROR 0xFF       // Verdict of a line that is not valid JSON
+#define NDJSON_BLANK 0xFE             // Empty line, counted for numbering but not reported
+
+struct Chunk
+{
+    const char *begin;
+    const char *end;
+    std::vector<uint8_t> verdicts; // One per line: ValidationError, or NDJSON_PARSE_ERROR
+    std::vector<std::string> keys; // Failing key of each failed line, in order
+    std::atomic<bool> done{false};
+};
+
+struct Options
+{
+    unsigned threads = 0;
+    bool quiet = false;
+    size_t capacity = 0;
+    const char *schemaPath = nullptr;
+    const char *inputPath = nullptr;
+};
+
+static const char *errorName(uint8_t verdict)
+{
+    static const char *const names[] = {"ok", "missing_required", "wrong_type", "value_out_of_range", "length_out_of_range",
+                                        "items_out_of_range", "pattern_mismatch", "pattern_invalid", "pattern_budget_exceeded",
+                                        "cross_field_violation", "unknown_key", "too_many_keys", "no_capacity", "invalid_encoding", "decrypt_failed"};
+    if (verdict == NDJSON_PARSE_ERROR)
+        return "parse_error";
+    return verdict < sizeof(names) / sizeof(names[0]) ? names[verdict] : "unknown_error";
+}
+
+static bool readFile(const char *path, std::vector<char> &out)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        out.insert(out.end(), buffer, buffer + n);
+    fclose(file);
+    return true;
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i)
+    {
+        if (strcmp(argv[i], "-q") == 0)
+            options.quiet = true;
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            options.threads = strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            options.capacity = strtoul(argv[++i], nullptr, 10);
+        else
+            return false;
+    }
+    if (argc - i != 2)
+        return false;
+    options.schemaPath = argv[i];
+    options.inputPath = argv[i + 1];
+    return true;
+}
+//-------------------------------------------------------------------
+// Work-stealing pool: each worker drains its own deque from the front and steals from the back of the
+// others, so neighbouring chunks stay on one thread until the load runs uneven.
+class ChunkPool
+{
+public:
+    ChunkPool(size_t chunks, unsigned workers) : queues_(workers)
+    {
+        for (size_t i = 0; i < chunks; ++i)
+            queues_[i * workers / chunks].items.push_back(i); // contiguous blocks per worker
+    }
+
+    bool next(unsigned worker, size_t &chunk)
+    {
+        for (unsigned k = 0; k < queues_.size(); ++k)
+        {
+            Queue &queue = queues_[(worker + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.items.empty())
+                continue;
+            if (k == 0)
+            {
+                chunk = queue.items.front();
+                queue.items.pop_front();
+            }
+            else
+            {
+                chunk = queue.items.back();
+                queue.items.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+    std::vector<Queue> queues_;
+};
+//-------------------------------------------------------------------
+static void validateChunk(const Validator &validator, bool arraySchema, JsonVariantConst filter, bool filtered,
+                          DynamicJsonDocument &doc, Chunk &chunk)
+{
+    const char *line = chunk.begin;
+    while (line < chunk.end)
+    {
+        const char *newline = (const char *)memchr(line, '\n', chunk.end - line);
+        const char *end = newline ? newline : chunk.end;
+        size_t length = end - line;
+        if (length && line[length - 1] == '\r')
+            --length;
+
+        if (length == 0)
+        {
+            chunk.verdicts.push_back(NDJSON_BLANK);
+            line = end + 1;
+            continue;
+        }
+
+        uint8_t verdict = (uint8_t)ValidationError::None;
+        ValidationContext ctx;
+        DeserializationError error = filtered ? deserializeJson(doc, line, length, DeserializationOption::Filter(filter))
+                                              : deserializeJson(doc, line, length);
+        if (error == DeserializationError::NoMemory)
+            verdict = (uint8_t)ValidationError::NoCapacity; // larger than the schema allows
+        else if (error)
+            verdict = NDJSON_PARSE_ERROR;
+        else if (!(arraySchema ? validator.isArrayValid(doc.as<JsonVariant>(), ctx) : validator.isValid(doc.as<JsonVariant>(), ctx)))
+            verdict = (uint8_t)ctx.error;
+
+        chunk.verdicts.push_back(verdict);
+        if (verdict != (uint8_t)ValidationError::None)
+            chunk.keys.push_back(ctx.failedField ? ctx.failedField : "");
+        line = end + 1;
+    }
+}
+
+// Chunks of about NDJSON_CHUNK_BYTES, each ending just after a newline (or at the end of the input)
+static std::vector<Chunk> splitChunks(const char *data, size_t size)
+{
+    std::deque<std::pair<const char *, const char *>> bounds;
+    const char *begin = data, *end = data + size;
+    while (begin < end)
+    {
+        const char *cut = begin + std::min<size_t>(NDJSON_CHUNK_BYTES, end - begin);
+        if (cut < end)
+        {
+            const char *newline = (const char *)memchr(cut, '\n', end - cut);
+            cut = newline ? newline + 1 : end;
+        }
+        bounds.emplace_back(begin, cut);
+        begin = cut;
+    }
+    std::vector<Chunk> chunks(bounds.size());
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        chunks[i].begin = bounds[i].first;
+        chunks[i].end = bounds[i].second;
+    }
+    return chunks;
+}
+//-------------------------------------------------------------------
+// Buffered stdout writer with a hand-rolled integer formatter; printf per line would cap throughput.
+class Output
+{
+public:
+    ~Output() { flush(); }
+
+    void line(unsigned long long number, const char *verdict, const std::string *key)
+    {
+        char digits[24];
+        int n = 0;
+        do
+        {
+            digits[n++] = '0' + number % 10;
+            number /= 10;
+        } while (number);
+        while (n)
+            buffer_ += digits[--n];
+        buffer_ += '\t';
+        buffer_ += verdict;
+        if (key && !key->empty())
+        {
+            buffer_ += '\t';
+            buffer_ += *key;
+        }
+        buffer_ += '\n';
+        if (buffer_.size() > (1u << 16))
+            flush();
+    }
+
+    void flush()
+    {
+        fwrite(buffer_.data(), 1, buffer_.size(), stdout);
+        buffer_.clear();
+    }
+
+private:
+    std::string buffer_;
+};
+//-------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        fprintf(stderr, "usage: %s [-j threads] [-q] [-c capacity] <schema.json> <payloads.ndjson>\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<char> text;
+    if (!readFile(options.schemaPath, text))
+    {
+        fprintf(stderr, "cannot read %s\n", options.schemaPath);
+        return 2;
+    }
+    DynamicJsonDocument schemaDoc(text.size() * 4 + 1024);
+    DeserializationError error = deserializeJson(schemaDoc, text.data(), text.size());
+    Validator validator;
+    bool arraySchema = false;
+    if (error || !SchemaLoader::load(schemaDoc.as<JsonVariant>(), validator, &arraySchema))
+    {
+        fprintf(stderr, "%s: unsupported or invalid schema\n", options.schemaPath);
+        return 2;
+    }
+
+    int fd = open(options.inputPath, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        fprintf(stderr, "cannot open %s\n", options.inputPath);
+        return 2;
+    }
+    size_t size = info.st_size;
+    const char *data = nullptr;
+    if (size)
+    {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            fprintf(stderr, "cannot map %s\n", options.inputPath);
+            return 2;
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = (const char *)mapping;
+    }
+    close(fd);
+
+    // Same sizing as on a device: schema bound and key filter, when the schema allows them
+    size_t capacity = options.capacity;
+    if (capacity == 0)
+        capacity = arraySchema ? 0 : validator.documentCapacity();
+    if (capacity == 0)
+        capacity = NDJSON_DEFAULT_CAPACITY;
+    DynamicJsonDocument filter(validator.filterCapacity());
+    bool filtered = validator.buildFilter(filter, arraySchema);
+    JsonVariantConst filterView = filter.as<JsonVariantConst>(); // read-only, shared by the workers
+
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<Chunk> chunks = splitChunks(data, size);
+    ChunkPool pool(chunks.size(), threads);
+    std::mutex doneMutex;
+    std::condition_variable doneSignal;
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads; ++w)
+    {
+        workers.emplace_back([&, w]()
+                             {
+                                 DynamicJsonDocument doc(capacity);
+                                 size_t index;
+                                 while (pool.next(w, index))
+                                 {
+                                     validateChunk(validator, arraySchema, filterView, filtered, doc, chunks[index]);
+                                     {
+                                         std::lock_guard<std::mutex> lock(doneMutex);
+                                         chunks[index].done.store(true, std::memory_order_release);
+                                     }
+                                     doneSignal.notify_all();
+                                 } });
+    }
+
+    // Verdicts in input order, as chunks complete; each chunk's results are freed once written
+    Output out;
+    unsigned long long lineNumber = 0, lines = 0, valid = 0;
+    unsigned long long counts[256] = {0};
+    for (Chunk &chunk : chunks)
+    {
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneSignal.wait(lock, [&]()
+                            { return chunk.done.load(std::memory_order_acquire); });
+        }
+        size_t failure = 0;
+        for (uint8_t verdict : chunk.verdicts)
+        {
+            ++lineNumber;
+            if (verdict == NDJSON_BLANK)
+                continue;
+            ++lines;
+            ++counts[verdict];
+            if (verdict == (uint8_t)ValidationError::None)
+            {
+                ++valid;
+                if (!options.quiet)
+                    out.line(lineNumber, "ok", nullptr);
+            }
+            else
+                out.line(lineNumber, errorName(verdict), &chunk.keys[failure++]);
+        }
+        std::vector<uint8_t>().swap(chunk.verdicts);
+        std::vector<std::string>().swap(chunk.keys);
+    }
+    out.flush();
+    for (std::thread &worker : workers)
+        worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    fprintf(stderr, "lines %llu  valid %llu  invalid %llu  (%u threads, %zu chunks, %s)\n", lines, valid, lines - valid, threads,
+            chunks.size(), filtered ? "filtered" : "unfiltered");
+    for (int verdict = 1; verdict < 256; ++verdict)
+    {
+        if (counts[verdict])
+            fprintf(stderr, "  %-24s %llu\n", errorName(verdict), counts[verdict]);
+    }
+    fprintf(stderr, "%.3f s, %.1f MB/s, %.0f lines/s\n", seconds, size / seconds / 1e6, lines / seconds);
+
+    if (data)
+        munmap((void *)data, size);
+    return valid == lines ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+//===========================================================================================================================================
+// schemaCodegen - Linux host tool
+//
+// Generates a specialised validator function (and its self-test) from a JSON schema file:
+//
+//   schemaCodegen <schema.json> <functionName> <outputDir>
+//     -> <outputDir>/<functionName>.h           bool functionName(const JsonVariant &json)
+//     -> <outputDir>/<functionName>_selftest.h  bool functionName_selftest(const Validator &reference, DeserializationError *parseError)
+//
+// Built against a host Arduino core (e.g. EpoxyDuino) plus ArduinoJson 6:
+//   g++ -std=gnu++17 -I<core> -I<ArduinoJson>/src -Isrc tools/schemaCodegen.cpp src/PAT_dataValidator.cpp -o schemaCodegen
+//-------------------------------------------------------------------
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <cstdio>
+#include <vector>
+#include "../src/PAT_dataValidator.h"
+#include "../src/PAT_schemaLoader.h"
+#include "../src/PAT_schemaCodegen.h"
+
+static bool readFile(const char *path, std::vector<char> &out)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        out.insert(out.end(), buffer, buffer + n);
+    fclose(file);
+    return true;
+}
+
+static bool writeFile(const String &path, const String &content)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(content.c_str(), 1, content.length(), file) == content.length();
+    return fclose(file) == 0 && ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "usage: %s <schema.json> <functionName> <outputDir>\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<char> text;
+    if (!readFile(argv[1], text))
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    DynamicJsonDocument schemaDoc(text.size() * 4 + 1024);
+    DeserializationError error = deserializeJson(schemaDoc, text.data(), text.size());
+    if (error)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+
+    Validator validator;
+    bool arraySchema = false;
+    if (!SchemaLoader::load(schemaDoc.as<JsonVariant>(), validator, &arraySchema))
+    {
+        fprintf(stderr, "%s: unsupported or invalid schema\n", argv[1]);
+        return 1;
+    }
+    if (arraySchema)
+    {
+        fprintf(stderr, "%s: array schemas are not supported; generated validators check one object\n", argv[1]);
+        return 1;
+    }
+
+    const char *reason = SchemaCodegen::unsupportedReason(validator, argv[2]);
+    if (reason)
+    {
+        fprintf(stderr, "cannot generate %s: %s\n", argv[2], reason);
+        return 1;
+    }
+    String code = SchemaCodegen::emit(validator, argv[2]);
+    String test = SchemaCodegen::emitSelfTest(validator, argv[2]);
+
+    String base = String(argv[3]) + "/" + argv[2];
+    if (!writeFile(base + ".h", code) || !writeFile(base + "_selftest.h", test))
+    {
+        fprintf(stderr, "cannot write to %s\n", argv[3]);
+        return 1;
+    }
+    return 0;
+}